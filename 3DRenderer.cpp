@@ -2,22 +2,16 @@
 #include <SFML/Window.hpp>
 #include <GL/glew.h>
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <string>
 #include <vector>
 #include <algorithm>
 #include <cmath>
 #include <glm/glm.hpp>
 
-#include "Mesh.h"
-#include "Shader.h"
 #include "Camera.h"
 #include "Scene.h"
-#include "GBuffer.h"
-#include "Quad.h"
-
-std::string ReadTextFile(const std::string& fileName);
+#include "Renderer.h"
+#include "Stats.h"
 
 int main(int argc, char** argv){
 
@@ -26,6 +20,7 @@ int main(int argc, char** argv){
     settings.majorVersion = 3;
     settings.minorVersion = 3;
     settings.depthBits = 24;
+    settings.stencilBits = 8; // Match the G-buffer's DEPTH24_STENCIL8 so its depth can be blitted in
     settings.attributeFlags = sf::ContextSettings::Core;
 
     sf::Window window(sf::VideoMode({800,800}), "3D OpenGL", sf::Style::Default, sf::State::Windowed, settings);
@@ -39,6 +34,12 @@ int main(int argc, char** argv){
 
     std::string fileName = "untitled.fbx";
     Mode mode = HYBRID;
+    LightingPath lightingPath = LIGHTING_FULLSCREEN;
+    ForwardLighting forwardLighting = FORWARD_ALL_LIGHTS;
+    bool occlusionCulling = false;
+    bool mergedGeometry = false;
+    GBufferLayout gbufferLayout = GBUFFER_FULL;
+    bool adaptiveHybrid = false;
     if (argc > 1) fileName = argv[1]; 
     if (argc > 2){
         std::string modeArg(argv[2]);
@@ -46,186 +47,140 @@ int main(int argc, char** argv){
         else if (modeArg == "f" || modeArg == "forward") mode = FORWARD;
         else if (modeArg == "h" || modeArg == "hybrid") mode = HYBRID;
     }
+    if (argc > 3){
+        std::string lightingArg(argv[3]);
+        if (lightingArg == "t" || lightingArg == "tiled") lightingPath = LIGHTING_TILED;
+        else if (lightingArg == "v" || lightingArg == "volumes") lightingPath = LIGHTING_VOLUMES;
+        else if (lightingArg == "fullscreen") lightingPath = LIGHTING_FULLSCREEN;
+    }
+    if (argc > 4){
+        std::string forwardArg(argv[4]);
+        if (forwardArg == "c" || forwardArg == "clustered") forwardLighting = FORWARD_CLUSTERED;
+        else if (forwardArg == "all") forwardLighting = FORWARD_ALL_LIGHTS;
+    }
+    if (argc > 5){
+        std::string occlusionArg(argv[5]);
+        occlusionCulling = occlusionArg == "o" || occlusionArg == "occlusion";
+    }
+    if (argc > 6){
+        std::string geometryArg(argv[6]);
+        mergedGeometry = geometryArg == "m" || geometryArg == "merged";
+    }
+    if (argc > 7){
+        std::string vertexArg(argv[7]);
+        if (vertexArg == "c" || vertexArg == "compressed") Scene::VERTEX_FORMAT = VERTEX_COMPRESSED;
+    }
+    if (argc > 8){
+        std::string gbufferArg(argv[8]);
+        if (gbufferArg == "c" || gbufferArg == "compact") gbufferLayout = GBUFFER_COMPACT;
+        else if (gbufferArg == "m" || gbufferArg == "material-id") gbufferLayout = GBUFFER_MATERIAL_ID;
+    }
+    if (argc > 9){
+        std::string adaptiveArg(argv[9]);
+        adaptiveHybrid = adaptiveArg == "a" || adaptiveArg == "adaptive";
+    }
+
+    // Device costs for the hybrid classification, measured once and kept in cost_profile.txt
+    Scene::COST_MODEL = CostModel::LoadOrCalibrate("cost_profile.txt", gbufferLayout);
+    std::cout << "Cost model: " << Scene::COST_MODEL.Summary() << std::endl;
 
-    Quad quad;
-    GBuffer gbuffer((int)window.getSize().x, (int)window.getSize().y);
-    Shader gbufferShader(ReadTextFile("gbuffer_vert.glsl"), ReadTextFile("gbuffer_frag.glsl"));
-    Shader lightingShader(ReadTextFile("lighting_vert.glsl"), ReadTextFile("lighting_frag.glsl"));
-    Shader forwardShader(ReadTextFile("forward_vertex.glsl"), ReadTextFile("forward_fragment.glsl"));
+    Renderer renderer((int)window.getSize().x, (int)window.getSize().y, gbufferLayout);
+    renderer.lightingPath = lightingPath;
+    renderer.forwardLighting = forwardLighting;
+    renderer.occlusionCulling = occlusionCulling;
+    renderer.mergedGeometry = mergedGeometry;
+    renderer.adaptiveHybrid = adaptiveHybrid;
+    renderer.timePasses = true; // Frame statistics come from the GPU pass timers
 
     Scene scene(fileName);
+    std::cout << "Vertex + index buffers: " << scene.GetGeometryBytes() / (1024.0f * 1024.0f) << " MB ("
+              << scene.GetFloatLayoutGeometryBytes() / (1024.0f * 1024.0f) << " MB as float)" << std::endl;
 
     Camera camera = scene.camera;
     
-    // Set up view/projection for overdraw measurement
-    gbufferShader.Use();
-    gbufferShader.SetValue("view", camera.GetViewMatrix());
-    gbufferShader.SetValue("projection", camera.GetProjectionMatrix((float)window.getSize().x, (float)window.getSize().y));
-    
     // Measure preprocessing time (overdraw detection and heuristic evaluation)
     sf::Clock preprocessClock;
-    scene.UpdateRenderingMode(gbufferShader, window.getSize().x, window.getSize().y, mode);
+    renderer.Prepare(scene, mode);
     float preprocessTime = preprocessClock.getElapsedTime().asSeconds() * 1000.0f; // Convert to milliseconds
 
-    // Calculate exposure based on number of lights
-    size_t numLights = scene.GetLightCount();
-    float exposure;
-    if (numLights == 0) {
-        exposure = 1.0f; // No lights, use standard exposure
-    } else if (numLights <= 5) {
-        exposure = 1.0f; // Few lights: standard exposure
-    } else if (numLights <= 20) {
-        exposure = 0.5f; // Moderate lights: reduce exposure
-    } else if (numLights <= 50) {
-        exposure = 0.3f; // Many lights: lower exposure
-    } else {
-        exposure = 0.1f; // Very many lights: very low exposure
-    }
-    
-    lightingShader.Use();
-    lightingShader.SetValue("viewPos", camera.position);
-    lightingShader.SetValue("ambientStrength", 0.1f);
-    lightingShader.SetValue("ambientColor", glm::vec3(1.0f));
-    lightingShader.SetValue("exposure", exposure);
-    forwardShader.Use();
-    forwardShader.SetValue("ambientStrength", 0.1f);
-    forwardShader.SetValue("ambientColor", glm::vec3(1.0f));
-    forwardShader.SetValue("exposure", exposure);
-    forwardShader.SetValue("view", camera.GetViewMatrix());
-    forwardShader.SetValue("projection", camera.GetProjectionMatrix((float)window.getSize().x, (float)window.getSize().y));
-    forwardShader.SetValue("viewPos", camera.position);
-
-
-    // Benchmarking configuration
+
+    // Benchmarking configuration. Frames are timed on the GPU per pass (GpuProfiler), read
+    // back a few frames late, so the render loop is never stalled with glFinish
     const int WARMUP_FRAMES = 10;  // Skip first N frames for warm-up
     const int SAMPLE_FRAMES = 100; // Collect M frames for statistics
-    std::vector<float> renderTimes;
-    renderTimes.reserve(SAMPLE_FRAMES);
     
     int frameCount = 0;
-    sf::Clock clock{};
     bool statsPrinted = false;
+    TimingSummary overdrawTime; // GPU time of the overdraw measurement in Prepare
     
     while (window.isOpen()){
         while (const std::optional event = window.pollEvent()){
             if (event->is<sf::Event::Closed>())
                 window.close();
         }
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        //-----------------------------------
-        // 1. Deferred G-buffer pass
-        //-----------------------------------
-        gbuffer.BindForWriting();
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        gbufferShader.Use();
-
-        // Ensure previous frame is complete before timing
-        if (frameCount >= WARMUP_FRAMES) {
-            glFinish();
-            clock.restart(); // Start timing the actual rendering work
-        }
-        
-        int deferredCount = scene.DrawDeferred(gbufferShader);
-
-        //-----------------------------------
-        // 2. Deferred Lighting Pass
-        //-----------------------------------
-        if (deferredCount > 0) {
-            gbuffer.BindForReading();
-
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
-            glViewport(0, 0, window.getSize().x, window.getSize().y);
-            
-            glDisable(GL_DEPTH_TEST);
-            
-            lightingShader.Use();
-            scene.SetLights(lightingShader);
-            gbuffer.BindTextures(lightingShader.programID);
-            quad.Draw();
-            
-            glEnable(GL_DEPTH_TEST);
-        } else {
-            // Skip lighting pass if no deferred objects
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
-            glViewport(0, 0, window.getSize().x, window.getSize().y);
-        }
-
-
-        //-----------------------------------
-        // 3. Forward Pass 
-        //-----------------------------------
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-        forwardShader.Use();
+        renderer.RefreshRenderingMode(scene, camera);
+        Renderer::FrameResult frame = renderer.RenderFrame(scene, camera);
+        if (adaptiveHybrid) renderer.Adapt(scene);
+        renderer.profiler.Collect();
 
-        int forwardCount = scene.DrawForward(forwardShader);
-
-        glDisable(GL_BLEND);
-
-        // Collect render time sample (after warm-up period)
-        if (frameCount >= WARMUP_FRAMES && frameCount < WARMUP_FRAMES + SAMPLE_FRAMES) {
-            glFinish(); // Ensure GPU work is complete
-            float renderTime = clock.getElapsedTime().asSeconds() * 1000.0f; // Convert to milliseconds
-            renderTimes.push_back(renderTime);
-        }
-        
+        // Start collecting samples after the warm-up period
         frameCount++;
+        if (frameCount == WARMUP_FRAMES) {
+            overdrawTime = renderer.profiler.Summary(GPU_PASS_OVERDRAW);
+            renderer.profiler.ResetHistory();
+        }
 
         // Calculate and print statistics after collecting all samples
-        if (!statsPrinted && frameCount >= WARMUP_FRAMES + SAMPLE_FRAMES) {
-            // Calculate statistics
-            if (!renderTimes.empty()) {
-                std::sort(renderTimes.begin(), renderTimes.end());
-                
-                // Mean
-                float sum = 0.0f;
-                for (float time : renderTimes) {
-                    sum += time;
-                }
-                float mean = sum / renderTimes.size();
-                
-                // Median
-                float median = renderTimes.size() % 2 == 0
-                    ? (renderTimes[renderTimes.size() / 2 - 1] + renderTimes[renderTimes.size() / 2]) / 2.0f
-                    : renderTimes[renderTimes.size() / 2];
-                
-                // Min/Max
-                float minTime = renderTimes.front();
-                float maxTime = renderTimes.back();
-                
-                // Standard deviation
-                float variance = 0.0f;
-                for (float time : renderTimes) {
-                    float diff = time - mean;
-                    variance += diff * diff;
-                }
-                float stdDev = std::sqrt(variance / renderTimes.size());
-                
-                float gbufferMemory = gbuffer.GetMemoryUsageMB();
-                std::cout << "Render Stats - Deferred: " << deferredCount 
-                          << " objects, Forward: " << forwardCount 
-                          << " objects" << std::endl;
-                std::cout << "Render time: mean=" << mean << " ms (median=" << median 
-                          << ", stddev=" << stdDev << ", min=" << minTime 
-                          << ", max=" << maxTime << ")" << std::endl;
-                std::cout << "Preprocess time: " << preprocessTime << " ms"
-                          << ", G-buffer memory: " << gbufferMemory << " MB" << std::endl;
+        if (!statsPrinted && frameCount > WARMUP_FRAMES && renderer.profiler.GetSampleCount() >= SAMPLE_FRAMES) {
+            TimingSummary stats = renderer.profiler.FrameSummary();
+            
+            float gbufferMemory = renderer.gbuffer.GetMemoryUsageMB();
+            std::cout << "Render Stats - Deferred: " << frame.deferredCount 
+                      << " objects, Forward: " << frame.forwardCount 
+                      << " objects" << std::endl;
+            std::cout << "Frustum culling: " << frame.visibleMeshes << " visible, "
+                      << frame.culledMeshes << " culled" << std::endl;
+            if (occlusionCulling) {
+                std::cout << "Occlusion culling: " << frame.occludedMeshes << " occluded, "
+                          << frame.occlusionQueries << " queries issued" << std::endl;
+            }
+            if (lightingPath == LIGHTING_TILED) {
+                std::cout << "Tiled lighting: " << frame.tileLightIndices << " light-tile pairs, "
+                          << (float)frame.tileLightIndices / renderer.tiledLighting.GetTileCount()
+                          << " lights per tile" << std::endl;
+            }
+            if (forwardLighting == FORWARD_CLUSTERED) {
+                std::cout << "Clustered forward: " << frame.clusterLightIndices << " light-cluster pairs, "
+                          << (float)frame.clusterLightIndices / renderer.clusteredLighting.GetClusterCount()
+                          << " lights per cluster" << std::endl;
+            }
+            if (adaptiveHybrid) {
+                size_t kept = 0;
+                for (const AdaptiveHybrid::Decision& decision : renderer.adaptive.GetDecisions()) kept += decision.kept ? 1 : 0;
+                std::cout << "Adaptive hybrid: " << renderer.adaptive.GetDecisions().size() << " trials, "
+                          << kept << " moves kept" << std::endl;
             }
+            std::cout << "GPU render time: mean=" << stats.mean << " ms (median=" << stats.median 
+                      << ", stddev=" << stats.stdDev << ", min=" << stats.min 
+                      << ", max=" << stats.max << ", " << renderer.profiler.GetRejectedCount()
+                      << " samples rejected)" << std::endl;
+            for (GpuPass pass : {GPU_PASS_GBUFFER, GPU_PASS_LIGHTING, GPU_PASS_FORWARD}) {
+                TimingSummary passStats = renderer.profiler.Summary(pass);
+                std::cout << "  " << GpuPassName(pass) << ": median=" << passStats.median << " ms, p95="
+                          << passStats.p95 << ", p99=" << passStats.p99 << std::endl;
+            }
+            std::cout << "  overdraw measurement: " << overdrawTime.mean << " ms" << std::endl;
+            std::cout << "Preprocess time: " << preprocessTime << " ms"
+                      << ", G-buffer memory: " << gbufferMemory << " MB" << std::endl;
+            std::cout << "Render queue: " << frame.materialChanges << " material changes, "
+                      << frame.drawCalls << " draw calls" << std::endl;
+            std::cout << "Uniforms per frame: " << frame.uniforms.uploads << " uploaded, "
+                      << frame.uniforms.redundantSkipped << " redundant skipped, "
+                      << frame.uniforms.lookupsAvoided << " glGetUniformLocation calls avoided" << std::endl;
             statsPrinted = true;
         }
 
         window.display();
     }
 }
-
-std::string ReadTextFile(const std::string& fileName){
-    std::ifstream file(fileName);
-
-    std::stringstream ss{};
-    ss << file.rdbuf();
-    file.close();
-
-    return ss.str();
-}
\ No newline at end of file
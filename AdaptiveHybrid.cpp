@@ -0,0 +1,87 @@
+#include "AdaptiveHybrid.h"
+
+#include <iostream>
+#include <unordered_map>
+
+void AdaptiveHybrid::Reset(const Scene& scene, bool enabled, size_t nextFrame){
+    groups.clear();
+    decisions.clear();
+    phase = BASELINE;
+    nextGroup = 0;
+    firstValidFrame = nextFrame;
+    windowSum = 0.0;
+    windowSamples = 0;
+    if (!enabled) return;
+
+    // Transparent instances have to stay forward, so they never join a group
+    std::unordered_map<size_t, size_t> groupOfMaterial;
+    for (size_t i = 0; i < scene.GetInstanceCount(); i++) {
+        size_t material = scene.GetMesh(scene.GetInstance(i).mesh).materialIndex;
+        if (scene.GetMaterial(material).opacity < 1.0f) continue;
+        auto inserted = groupOfMaterial.emplace(material, groups.size());
+        if (inserted.second) {
+            groups.push_back(Group());
+            groups.back().material = material;
+        }
+        groups[inserted.first->second].instances.push_back((uint32_t)i);
+    }
+}
+
+bool AdaptiveHybrid::Update(Scene& scene, size_t sampleFrame, float passMs, size_t nextFrame){
+    if (groups.empty() || sampleFrame < firstValidFrame) return false;
+
+    windowSum += passMs;
+    if (++windowSamples < WINDOW_FRAMES) return false;
+    float meanMs = (float)(windowSum / windowSamples);
+    windowSum = 0.0;
+    windowSamples = 0;
+    firstValidFrame = nextFrame;
+
+    if (phase == BASELINE) {
+        baselineMs = meanMs;
+
+        // Next group that is not cooling down from a kept move
+        for (size_t tries = 0; tries < groups.size(); tries++) {
+            Group& group = groups[nextGroup];
+            activeGroup = nextGroup;
+            nextGroup = (nextGroup + 1) % groups.size();
+            if (group.cooldown > 0) {
+                group.cooldown--;
+                continue;
+            }
+
+            // Move the whole group to the path fewer of its instances are on
+            size_t forwardCount = 0;
+            group.saved.resize(group.instances.size());
+            for (size_t k = 0; k < group.instances.size(); k++) {
+                group.saved[k] = scene.GetInstance(group.instances[k]).useForward ? 1 : 0;
+                forwardCount += group.saved[k];
+            }
+            activeToForward = forwardCount * 2 < group.instances.size();
+            for (uint32_t i : group.instances) {
+                scene.SetInstanceForward(i, activeToForward);
+            }
+            phase = TRIAL;
+            return true;
+        }
+        return false;
+    }
+
+    // Trial window done: keep the move only if it is clearly faster
+    Group& group = groups[activeGroup];
+    bool kept = meanMs < baselineMs * (1.0f - HYSTERESIS);
+    if (kept) {
+        group.cooldown = COOLDOWN_TRIALS;
+    } else {
+        for (size_t k = 0; k < group.instances.size(); k++) {
+            scene.SetInstanceForward(group.instances[k], group.saved[k] != 0);
+        }
+    }
+    decisions.push_back({sampleFrame, group.material, activeToForward, (int)group.instances.size(),
+                         baselineMs, meanMs, kept});
+    std::cout << "Adaptive: material " << group.material << " (" << group.instances.size() << " instances) to "
+              << (activeToForward ? "forward" : "deferred") << ": " << baselineMs << " -> " << meanMs << " ms --> "
+              << (kept ? "Kept" : "Reverted") << std::endl;
+    phase = BASELINE;
+    return !kept;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Scene.h"
+
+#include <vector>
+#include <cstdint>
+
+// Closed-loop hybrid classification. The opaque instances are grouped by material; the
+// controller keeps measuring the GPU time of the G-buffer, lighting and forward passes
+// (GpuProfiler::FrameTimes) over WINDOW_FRAMES frames, then trials moving one group wholly to
+// the other path for another window. The move is kept only if it beats the window before
+// it by more than HYSTERESIS, and a kept group sits out COOLDOWN_TRIALS trials before it
+// may move back, so the split does not oscillate between two near-equal assignments.
+class AdaptiveHybrid{
+public:
+    static const int WINDOW_FRAMES = 16;       // Measured frames per baseline and per trial
+    static constexpr float HYSTERESIS = 0.05f; // Relative gain a move needs to be kept
+    static const int COOLDOWN_TRIALS = 4;      // Trials a moved group is skipped for
+
+    struct Decision {
+        size_t frame;     // Renderer frame the trial ended on
+        size_t material;  // Group that was moved
+        bool toForward;
+        int instances;
+        float baselineMs; // Mean pass time of the window before the move
+        float trialMs;    // Mean pass time with the group moved
+        bool kept;
+    };
+
+    // Rebuild the groups from the scene's current classification (none when !enabled);
+    // measurement starts at nextFrame
+    void Reset(const Scene& scene, bool enabled, size_t nextFrame);
+
+    // Feed the pass time measured for sampleFrame. May move or restore a group, taking
+    // effect from nextFrame; returns true when the classification changed
+    bool Update(Scene& scene, size_t sampleFrame, float passMs, size_t nextFrame);
+
+    const std::vector<Decision>& GetDecisions() const { return decisions; }
+
+private:
+    struct Group {
+        size_t material;
+        std::vector<uint32_t> instances;
+        std::vector<uint8_t> saved; // useForward before the current trial
+        int cooldown = 0;
+    };
+    enum Phase { BASELINE, TRIAL };
+
+    std::vector<Group> groups;
+    std::vector<Decision> decisions;
+    Phase phase = BASELINE;
+    size_t nextGroup = 0;
+    size_t activeGroup = 0;
+    bool activeToForward = false;
+    size_t firstValidFrame = 0; // Samples of earlier frames predate the last change
+    double windowSum = 0.0;
+    int windowSamples = 0;
+    float baselineMs = 0.0f;
+};
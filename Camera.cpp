@@ -1,6 +1,8 @@
 #include "Camera.h"
 
 const glm::vec3 Camera::WorldUp = {0.0f, 1.0f, 0.0f};
+const float Camera::NearPlane = 0.1f;
+const float Camera::FarPlane = 100.0f;
 
 Camera::Camera(glm::vec3 position, float yaw, float pitch, float fov)
     : position(position), yaw(yaw), pitch(pitch), fov(fov), forward(), right(), up()
@@ -8,7 +10,7 @@ Camera::Camera(glm::vec3 position, float yaw, float pitch, float fov)
 }
 
 glm::mat4 Camera::GetProjectionMatrix(float width, float height){
-    return glm::perspective(glm::radians(fov), width / height, 0.1f, 100.0f);
+    return glm::perspective(glm::radians(fov), width / height, NearPlane, FarPlane);
 }
 
 void Camera::UpdateDirectionVectors(){
@@ -6,6 +6,8 @@
 class Camera{
 public:
     static const glm::vec3 WorldUp;
+    static const float NearPlane;
+    static const float FarPlane;
 
     // @param position Camera (x,y,z) 
     // @param yaw Euler Angle, 90deg = forward direction
@@ -0,0 +1,174 @@
+#include "ClusteredLighting.h"
+#include "Scene.h"
+#include "LightCulling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+ClusteredLighting::ClusteredLighting(int width, int height)
+    : width(width), height(height),
+      clustersX((width + TILE_SIZE - 1) / TILE_SIZE), clustersY((height + TILE_SIZE - 1) / TILE_SIZE),
+      sliceScale(DEPTH_SLICES / std::log(Camera::FarPlane / Camera::NearPlane)),
+      boundsProjection(0.0f), gridBuffer(), gridTexture(), indexBuffer(), indexTexture()
+{
+    int clusterCount = GetClusterCount();
+
+    glGenBuffers(1, &gridBuffer);
+    glGenTextures(1, &gridTexture);
+    glBindBuffer(GL_TEXTURE_BUFFER, gridBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, clusterCount * 2 * sizeof(uint32_t), nullptr, GL_STREAM_DRAW);
+    glBindTexture(GL_TEXTURE_BUFFER, gridTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, gridBuffer);
+
+    glGenBuffers(1, &indexBuffer);
+    glGenTextures(1, &indexTexture);
+    glBindBuffer(GL_TEXTURE_BUFFER, indexBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(uint32_t), nullptr, GL_STREAM_DRAW);
+    glBindTexture(GL_TEXTURE_BUFFER, indexTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, indexBuffer);
+
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    clusterGrid.resize(clusterCount * 2);
+    clusterMin.resize(clusterCount);
+    clusterMax.resize(clusterCount);
+}
+
+ClusteredLighting::~ClusteredLighting(){
+    glDeleteTextures(1, &gridTexture);
+    glDeleteBuffers(1, &gridBuffer);
+    glDeleteTextures(1, &indexTexture);
+    glDeleteBuffers(1, &indexBuffer);
+}
+
+int ClusteredLighting::SliceForDepth(float depth) const {
+    if (depth <= Camera::NearPlane) return 0;
+    int slice = (int)std::floor(std::log(depth / Camera::NearPlane) * sliceScale);
+    return std::min(std::max(slice, 0), DEPTH_SLICES - 1);
+}
+
+void ClusteredLighting::UpdateClusterBounds(const glm::mat4& projection){
+    if (projection == boundsProjection)
+        return;
+    boundsProjection = projection;
+
+    // View-space position of an NDC (x, y) at positive view depth d (symmetric perspective)
+    auto unproject = [&projection](float ndcX, float ndcY, float d){
+        return glm::vec3(ndcX * d / projection[0][0], ndcY * d / projection[1][1], -d);
+    };
+
+    for (int z = 0; z < DEPTH_SLICES; z++){
+        float nearDepth = Camera::NearPlane * std::exp(z / sliceScale);
+        float farDepth = Camera::NearPlane * std::exp((z + 1) / sliceScale);
+        for (int y = 0; y < clustersY; y++){
+            float ndcY0 = (float)(y * TILE_SIZE) / height * 2.0f - 1.0f;
+            float ndcY1 = std::min((float)((y + 1) * TILE_SIZE) / height, 1.0f) * 2.0f - 1.0f;
+            for (int x = 0; x < clustersX; x++){
+                float ndcX0 = (float)(x * TILE_SIZE) / width * 2.0f - 1.0f;
+                float ndcX1 = std::min((float)((x + 1) * TILE_SIZE) / width, 1.0f) * 2.0f - 1.0f;
+
+                glm::vec3 bmin(FLT_MAX), bmax(-FLT_MAX);
+                for (int c = 0; c < 8; c++){
+                    glm::vec3 p = unproject((c & 1) ? ndcX1 : ndcX0, (c & 2) ? ndcY1 : ndcY0,
+                                            (c & 4) ? farDepth : nearDepth);
+                    bmin = glm::min(bmin, p);
+                    bmax = glm::max(bmax, p);
+                }
+                int cluster = (z * clustersY + y) * clustersX + x;
+                clusterMin[cluster] = bmin;
+                clusterMax[cluster] = bmax;
+            }
+        }
+    }
+}
+
+void ClusteredLighting::Build(const Scene& scene, const glm::mat4& view, const glm::mat4& projection){
+    UpdateClusterBounds(projection);
+
+    const std::vector<Light>& lights = scene.GetLights();
+    std::vector<uint32_t> counts(GetClusterCount(), 0);
+
+    struct LightBounds {
+        TileRect rect;
+        int slice0, slice1;
+        glm::vec3 center; // View space
+        float radius;
+    };
+    std::vector<LightBounds> bounds(lights.size());
+
+    // Sphere vs cluster AABB (squared distance to the box)
+    auto overlapsCluster = [&](const LightBounds& b, int cluster){
+        glm::vec3 closest = glm::clamp(b.center, clusterMin[cluster], clusterMax[cluster]);
+        glm::vec3 d = closest - b.center;
+        return glm::dot(d, d) <= b.radius * b.radius;
+    };
+
+    for (size_t i = 0; i < lights.size(); i++){
+        LightBounds& b = bounds[i];
+        b.center = glm::vec3(view * glm::vec4(lights[i].position, 1.0f));
+        b.radius = lights[i].radius;
+        b.rect = ProjectSphereToTiles(b.center, b.radius, projection, Camera::NearPlane, width, height, TILE_SIZE);
+        b.slice0 = SliceForDepth(-b.center.z - b.radius);
+        b.slice1 = SliceForDepth(-b.center.z + b.radius);
+        if (-b.center.z - b.radius > Camera::FarPlane)
+            b.rect = TileRect{0, 0, -1, -1}; // Beyond the far plane
+
+        for (int z = b.slice0; z <= b.slice1; z++){
+            for (int y = b.rect.y0; y <= b.rect.y1; y++){
+                for (int x = b.rect.x0; x <= b.rect.x1; x++){
+                    int cluster = (z * clustersY + y) * clustersX + x;
+                    if (overlapsCluster(b, cluster))
+                        counts[cluster]++;
+                }
+            }
+        }
+    }
+
+    // Prefix sum into (offset, count) pairs, then scatter the light indices
+    uint32_t total = 0;
+    for (int c = 0; c < GetClusterCount(); c++){
+        clusterGrid[c * 2] = total;
+        clusterGrid[c * 2 + 1] = 0;
+        total += counts[c];
+    }
+    lightIndices.resize(total);
+
+    for (size_t i = 0; i < lights.size(); i++){
+        const LightBounds& b = bounds[i];
+        for (int z = b.slice0; z <= b.slice1; z++){
+            for (int y = b.rect.y0; y <= b.rect.y1; y++){
+                for (int x = b.rect.x0; x <= b.rect.x1; x++){
+                    int cluster = (z * clustersY + y) * clustersX + x;
+                    if (overlapsCluster(b, cluster))
+                        lightIndices[clusterGrid[cluster * 2] + clusterGrid[cluster * 2 + 1]++] = (uint32_t)i;
+                }
+            }
+        }
+    }
+
+    // Orphan and refill both buffers
+    glBindBuffer(GL_TEXTURE_BUFFER, gridBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, clusterGrid.size() * sizeof(uint32_t), clusterGrid.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, indexBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, std::max(lightIndices.size(), (size_t)1) * sizeof(uint32_t),
+                 lightIndices.empty() ? nullptr : lightIndices.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void ClusteredLighting::Bind(Shader& forwardShader) const {
+    glActiveTexture(GL_TEXTURE0 + GRID_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, gridTexture);
+    glActiveTexture(GL_TEXTURE0 + INDEX_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, indexTexture);
+
+    forwardShader.SetValue("clusterGrid", GRID_TEXTURE_UNIT);
+    forwardShader.SetValue("clusterLightIndices", INDEX_TEXTURE_UNIT);
+    forwardShader.SetValue("clusterTileSize", TILE_SIZE);
+    forwardShader.SetValue("clustersX", clustersX);
+    forwardShader.SetValue("clustersY", clustersY);
+    forwardShader.SetValue("clusterSlices", DEPTH_SLICES);
+    forwardShader.SetValue("clusterNear", Camera::NearPlane);
+    forwardShader.SetValue("clusterSliceScale", sliceScale);
+}
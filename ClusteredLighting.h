@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Shader.h"
+
+#include <vector>
+#include <glm/glm.hpp>
+#include <GL/glew.h>
+
+class Scene;
+
+// Clustered forward (Forward+) light lists for the forward pass.
+// The camera frustum is split into 64x64 pixel screen tiles and exponentially
+// spaced depth slices between the camera's near and far planes (froxels). Every
+// frame each light's sphere is tested against the view-space AABBs of the clusters
+// its screen rect and depth range touch, and the per-cluster (offset, count) grid
+// plus concatenated light indices are uploaded as texture buffers. The forward
+// shader built with CLUSTERED_LIGHTING looks up its cluster from gl_FragCoord and
+// view depth and loops only over that cluster's lights.
+class ClusteredLighting{
+public:
+    static const int TILE_SIZE = 64;
+    static const int DEPTH_SLICES = 24;
+    static const int GRID_TEXTURE_UNIT = 8;  // After TiledLighting's units
+    static const int INDEX_TEXTURE_UNIT = 9;
+
+    ClusteredLighting(int width, int height);
+    ~ClusteredLighting();
+    ClusteredLighting(const ClusteredLighting&) = delete;
+    ClusteredLighting& operator=(const ClusteredLighting&) = delete;
+
+    // Rebuild cluster light lists for the current camera
+    void Build(const Scene& scene, const glm::mat4& view, const glm::mat4& projection);
+
+    // Bind the cluster textures and set the cluster uniforms on the forward shader
+    void Bind(Shader& forwardShader) const;
+
+    size_t GetLightIndexCount() const { return lightIndices.size(); } // Sum of all cluster list lengths
+    int GetClusterCount() const { return clustersX * clustersY * DEPTH_SLICES; }
+
+private:
+    void UpdateClusterBounds(const glm::mat4& projection);
+    int SliceForDepth(float depth) const;
+
+    int width, height;
+    int clustersX, clustersY;
+    float sliceScale; // DEPTH_SLICES / log(far / near)
+
+    glm::mat4 boundsProjection;             // Projection the cluster AABBs were built for
+    std::vector<glm::vec3> clusterMin;      // View-space AABB per cluster
+    std::vector<glm::vec3> clusterMax;
+
+    GLuint gridBuffer, gridTexture;
+    GLuint indexBuffer, indexTexture;
+
+    std::vector<uint32_t> clusterGrid;      // (offset, count) per cluster
+    std::vector<uint32_t> lightIndices;     // Concatenated per-cluster light lists
+};
@@ -0,0 +1,321 @@
+#include "CostModel.h"
+#include "Renderer.h"
+#include "LightBuffer.h"
+#include "MaterialBuffer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace {
+
+const int LAYER_COUNTS[] = {2, 4, 8, 16};  // G-buffer layers per timed sample
+const int LIGHT_COUNTS[] = {0, 4, 8, 16};  // Lights per timed lighting/forward sample
+const int DRAWS_PER_SAMPLE = 4;            // Lighting/forward layers per timed sample
+const int REPEATS = 3;                     // Timed samples per point; the median is kept
+const float LAYER_DEPTH = 0.5f;            // NDC depth all layers are drawn at
+
+// Median wall time (ms) of draw(), fenced by glFinish on both sides
+template<typename Draw>
+float MedianMs(Draw draw){
+    std::vector<float> times;
+    for (int r = 0; r < REPEATS; r++) {
+        glFinish();
+        auto start = std::chrono::steady_clock::now();
+        draw();
+        glFinish();
+        times.push_back(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+// Least-squares line y = slope * x + intercept
+void FitLine(const std::vector<float>& x, const std::vector<float>& y, float& slope, float& intercept){
+    double n = (double)x.size(), sumX = 0.0, sumY = 0.0, sumXX = 0.0, sumXY = 0.0;
+    for (size_t i = 0; i < x.size(); i++) {
+        sumX += x[i];
+        sumY += y[i];
+        sumXX += (double)x[i] * x[i];
+        sumXY += (double)x[i] * y[i];
+    }
+    double denominator = n * sumXX - sumX * sumX;
+    slope = denominator != 0.0 ? (float)((n * sumXY - sumX * sumY) / denominator) : 0.0f;
+    intercept = (float)((sumY - slope * sumX) / n);
+}
+
+// Lights in front of the layers whose radius covers every pixel, so each one is shaded everywhere
+std::vector<Light> CalibrationLights(int count){
+    std::vector<Light> lights(count);
+    for (int i = 0; i < count; i++) {
+        lights[i].position = glm::vec3(std::sin((float)i), std::cos((float)i), 1.0f);
+        lights[i].color = glm::vec3(0.05f);
+        lights[i].radius = 1.0e4f;
+    }
+    return lights;
+}
+
+const char* LayoutName(GBufferLayout layout){
+    switch (layout){
+        case GBUFFER_COMPACT:     return "compact";
+        case GBUFFER_MATERIAL_ID: return "material-id";
+        default:                  return "full";
+    }
+}
+
+}
+
+std::string CostModel::CurrentDevice(){
+    const GLubyte* renderer = glGetString(GL_RENDERER);
+    return renderer ? std::string((const char*)renderer) : std::string("unknown");
+}
+
+CostModel CostModel::Calibrate(GBufferLayout layout){
+    CostModel model;
+    model.device = CurrentDevice();
+    model.layout = layout;
+
+    GLint oldViewport[4];
+    glGetIntegerv(GL_VIEWPORT, oldViewport);
+
+    const int size = CALIBRATION_SIZE;
+    const float pixels = (float)size * (float)size;
+    const float msToNsPerPixel = 1.0e6f / pixels;
+
+    // Camera the layers are unprojected with (and the lighting passes reconstruct from)
+    glm::vec3 viewPos(0.0f, 0.0f, 2.0f);
+    glm::mat4 view = glm::lookAt(viewPos, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 10.0f);
+    glm::mat4 inverseViewProjection = glm::inverse(projection * view);
+
+    GBuffer gbuffer(size, size, layout);
+    Quad quad;
+    LightBuffer lightBuffer;
+    MaterialBuffer materialBuffer;
+    Material material;
+    material.diffuse = glm::vec3(0.5f);
+    material.specular = glm::vec3(0.5f);
+    material.shininess = 32.0f;
+    materialBuffer.Upload({material});
+
+    // Color + depth target standing in for the output framebuffer
+    GLuint targetFBO, targetColor, targetDepth;
+    glGenFramebuffers(1, &targetFBO);
+    glGenTextures(1, &targetColor);
+    glGenRenderbuffers(1, &targetDepth);
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+    glBindTexture(GL_TEXTURE_2D, targetColor);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, targetColor, 0);
+    glBindRenderbuffer(GL_RENDERBUFFER, targetDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, size, size);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, targetDepth);
+
+    std::string calibrationVertex = ReadTextFile("calibration_vert.glsl");
+    Shader gbufferShader(Shader::WithDefines(calibrationVertex, {"GBUFFER_OUTPUT"}),
+                         GBuffer::WithLayout(ReadTextFile("gbuffer_frag.glsl"), layout));
+    Shader lightingShader(ReadTextFile("lighting_vert.glsl"),
+                          GBuffer::WithLayout(ReadTextFile("lighting_frag.glsl"), layout));
+    Shader forwardShader(calibrationVertex, ReadTextFile("forward_fragment.glsl"));
+
+    for (Shader* shader : {&gbufferShader, &forwardShader}) {
+        shader->Use();
+        shader->SetValue("layerDepth", LAYER_DEPTH);
+        shader->SetValue("inverseViewProjection", inverseViewProjection);
+        shader->SetValue("material.diffuse", material.diffuse);
+        shader->SetValue("material.specular", material.specular);
+        shader->SetValue("material.shininess", material.shininess);
+    }
+    gbufferShader.SetValue("materialIndex", 0);
+    forwardShader.SetValue("material.opacity", 1.0f);
+    for (Shader* shader : {&lightingShader, &forwardShader}) {
+        shader->Use();
+        shader->SetValue("viewPos", viewPos);
+        shader->SetValue("ambientStrength", 0.1f);
+        shader->SetValue("ambientColor", glm::vec3(1.0f));
+        shader->SetValue("exposure", 1.0f);
+    }
+
+    // Every layer covers every pixel and passes the depth test, so fragments = layers * pixels
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_ALWAYS);
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+
+    //-----------------------------------
+    // 1. G-buffer writes
+    //-----------------------------------
+    std::vector<float> x, y;
+    float slope, intercept;
+    gbuffer.BindForWriting();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+    gbufferShader.Use();
+    quad.Draw(); // Warm-up
+    for (int layers : LAYER_COUNTS) {
+        x.push_back((float)layers);
+        y.push_back(MedianMs([&]() {
+            for (int l = 0; l < layers; l++) quad.Draw();
+        }));
+    }
+    FitLine(x, y, slope, intercept);
+    model.gbufferPerFragment = std::max(slope, 0.0f) * msToNsPerPixel;
+
+    //-----------------------------------
+    // 2. Full-screen deferred lighting over the filled G-buffer
+    //-----------------------------------
+    glDisable(GL_DEPTH_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+    glViewport(0, 0, size, size);
+    gbuffer.BindForReading();
+    lightingShader.Use();
+    gbuffer.BindTextures(lightingShader);
+    if (layout != GBUFFER_FULL) {
+        lightingShader.SetValue("inverseViewProjection", inverseViewProjection);
+    }
+    if (layout == GBUFFER_MATERIAL_ID) {
+        materialBuffer.Bind();
+        lightingShader.SetValue("materialData", MaterialBuffer::TEXTURE_UNIT);
+    }
+    lightingShader.SetValue("lightData", LightBuffer::TEXTURE_UNIT);
+
+    x.clear();
+    y.clear();
+    for (int lights : LIGHT_COUNTS) {
+        lightBuffer.Upload(CalibrationLights(lights));
+        lightBuffer.Bind();
+        lightingShader.SetValue("numLights", lights);
+        quad.Draw(); // Warm-up
+        x.push_back((float)lights);
+        y.push_back(MedianMs([&]() {
+            for (int d = 0; d < DRAWS_PER_SAMPLE; d++) quad.Draw();
+        }) / DRAWS_PER_SAMPLE);
+    }
+    FitLine(x, y, slope, intercept);
+    model.lightingPerPixelLight = std::max(slope, 0.0f) * msToNsPerPixel;
+    model.lightingPerPixel = std::max(intercept, 0.0f) * msToNsPerPixel;
+
+    //-----------------------------------
+    // 3. Forward shading, blended like the forward pass
+    //-----------------------------------
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    forwardShader.Use();
+    forwardShader.SetValue("lightData", LightBuffer::TEXTURE_UNIT);
+
+    x.clear();
+    y.clear();
+    for (int lights : LIGHT_COUNTS) {
+        lightBuffer.Upload(CalibrationLights(lights));
+        lightBuffer.Bind();
+        forwardShader.SetValue("numLights", lights);
+        quad.Draw(); // Warm-up
+        x.push_back((float)lights);
+        y.push_back(MedianMs([&]() {
+            for (int d = 0; d < DRAWS_PER_SAMPLE; d++) quad.Draw();
+        }) / DRAWS_PER_SAMPLE);
+    }
+    FitLine(x, y, slope, intercept);
+    model.forwardPerFragmentLight = std::max(slope, 0.0f) * msToNsPerPixel;
+    model.forwardPerFragment = std::max(intercept, 0.0f) * msToNsPerPixel;
+
+    // Restore the state the renderer expects
+    glDisable(GL_BLEND);
+    glDepthFunc(GL_LESS);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(oldViewport[0], oldViewport[1], oldViewport[2], oldViewport[3]);
+
+    glDeleteFramebuffers(1, &targetFBO);
+    glDeleteTextures(1, &targetColor);
+    glDeleteRenderbuffers(1, &targetDepth);
+
+    model.valid = true;
+    return model;
+}
+
+std::string CostModel::Summary() const {
+    std::ostringstream out;
+    out << "G-buffer " << gbufferPerFragment << "/fragment, lighting " << lightingPerPixel << "/pixel + "
+        << lightingPerPixelLight << "/pixel-light, forward " << forwardPerFragment << "/fragment + "
+        << forwardPerFragmentLight << "/fragment-light (ns)";
+    return out.str();
+}
+
+bool CostModel::Save(const std::string& fileName) const {
+    std::ofstream out(fileName);
+    if (!out) {
+        std::cerr << "Warning: could not write cost profile " << fileName << "\n";
+        return false;
+    }
+    out << "# Hybrid cost model in ns, measured by CostModel::Calibrate\n";
+    out << "device " << device << "\n";
+    out << "layout " << LayoutName(layout) << "\n";
+    out << "gbuffer_per_fragment " << gbufferPerFragment << "\n";
+    out << "lighting_per_pixel " << lightingPerPixel << "\n";
+    out << "lighting_per_pixel_light " << lightingPerPixelLight << "\n";
+    out << "forward_per_fragment " << forwardPerFragment << "\n";
+    out << "forward_per_fragment_light " << forwardPerFragmentLight << "\n";
+    return true;
+}
+
+bool CostModel::Load(const std::string& fileName, GBufferLayout expectedLayout){
+    valid = false;
+    std::ifstream in(fileName);
+    if (!in) return false;
+
+    std::string line, fileLayout;
+    int costsRead = 0;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        size_t split = line.find(' ');
+        if (split == std::string::npos) continue;
+        std::string key = line.substr(0, split);
+        std::string value = line.substr(split + 1);
+        std::istringstream number(value);
+
+        if (key == "device") device = value;
+        else if (key == "layout") fileLayout = value;
+        else if (key == "gbuffer_per_fragment" && number >> gbufferPerFragment) costsRead++;
+        else if (key == "lighting_per_pixel" && number >> lightingPerPixel) costsRead++;
+        else if (key == "lighting_per_pixel_light" && number >> lightingPerPixelLight) costsRead++;
+        else if (key == "forward_per_fragment" && number >> forwardPerFragment) costsRead++;
+        else if (key == "forward_per_fragment_light" && number >> forwardPerFragmentLight) costsRead++;
+    }
+
+    if (costsRead != 5) {
+        std::cerr << "Warning: cost profile " << fileName << " is incomplete\n";
+        return false;
+    }
+    if (device != CurrentDevice()) {
+        std::cerr << "Warning: cost profile " << fileName << " was measured on " << device << "\n";
+        return false;
+    }
+    if (fileLayout != LayoutName(expectedLayout)) {
+        std::cerr << "Warning: cost profile " << fileName << " was measured with the " << fileLayout << " G-buffer\n";
+        return false;
+    }
+    layout = expectedLayout;
+    valid = true;
+    return true;
+}
+
+CostModel CostModel::LoadOrCalibrate(const std::string& fileName, GBufferLayout layout){
+    CostModel model;
+    if (model.Load(fileName, layout)) {
+        std::cout << "Loaded cost model from " << fileName << std::endl;
+        return model;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    model = Calibrate(layout);
+    float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Calibrated cost model on " << model.device << " in " << ms << " ms" << std::endl;
+    model.Save(fileName);
+    return model;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "GBuffer.h"
+
+#include <string>
+
+// Per-device GPU costs behind the hybrid classification (Scene::ShouldUseForward), in
+// nanoseconds. Calibrate times full-screen layers drawn with the renderer's own G-buffer,
+// lighting and forward shaders at increasing layer and light counts, and fits each cost
+// as the slope of a least-squares line; Save/Load keep the result in a profile file so
+// later runs on the same device skip the measurement.
+struct CostModel{
+    static const int CALIBRATION_SIZE = 256; // Offscreen targets are this many pixels square
+
+    float gbufferPerFragment = 0.0f;      // G-buffer pass, per fragment written
+    float lightingPerPixel = 0.0f;        // Full-screen lighting pass, per pixel with no lights
+    float lightingPerPixelLight = 0.0f;   // Full-screen lighting pass, per pixel and light in range
+    float forwardPerFragment = 0.0f;      // Forward pass, per fragment with no lights
+    float forwardPerFragmentLight = 0.0f; // Forward pass, per fragment and light
+    std::string device;                   // GL_RENDERER the costs were measured on
+    GBufferLayout layout = GBUFFER_FULL;
+    bool valid = false;
+
+    // Shading `fragments` (of which `visiblePixels` survive) lit by `lights`, either path.
+    // The deferred lighting pass's per-pixel base cost is paid once per frame, not per mesh
+    float ForwardCost(float fragments, float lights) const {
+        return fragments * (forwardPerFragment + lights * forwardPerFragmentLight);
+    }
+    float DeferredCost(float fragments, float visiblePixels, float lights) const {
+        return fragments * gbufferPerFragment + visiblePixels * lights * lightingPerPixelLight;
+    }
+
+    // Run the microbenchmarks on the current context (leaves framebuffer 0 bound)
+    static CostModel Calibrate(GBufferLayout layout);
+
+    // Plain "key value" lines. Load fails if the file is missing or was measured on
+    // another device or G-buffer layout
+    bool Save(const std::string& fileName) const;
+    bool Load(const std::string& fileName, GBufferLayout expectedLayout);
+
+    // Load fileName, or calibrate and (re)write it when that fails
+    static CostModel LoadOrCalibrate(const std::string& fileName, GBufferLayout layout);
+
+    std::string Summary() const; // The five costs on one line
+    static std::string CurrentDevice(); // GL_RENDERER of the current context
+};
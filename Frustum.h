@@ -0,0 +1,41 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// View frustum as six world-space planes (inside: dot(n, p) + d >= 0),
+// extracted from a view-projection matrix (Gribb/Hartmann)
+struct Frustum {
+    enum Result { OUTSIDE, INTERSECTING, INSIDE };
+
+    glm::vec4 planes[6]; // left, right, bottom, top, near, far
+
+    explicit Frustum(const glm::mat4& viewProjection) {
+        glm::vec4 rows[4];
+        for (int i = 0; i < 4; i++) {
+            rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+        }
+        for (int i = 0; i < 3; i++) {
+            planes[i * 2]     = rows[3] + rows[i];
+            planes[i * 2 + 1] = rows[3] - rows[i];
+        }
+    }
+
+    // Conservative AABB classification: boxes near frustum corners may report
+    // INTERSECTING while actually outside, never the reverse
+    Result TestAABB(const glm::vec3& boxMin, const glm::vec3& boxMax) const {
+        Result result = INSIDE;
+        for (const glm::vec4& plane : planes) {
+            glm::vec3 normal(plane);
+            // Corner farthest along the plane normal (positive vertex) and the opposite one
+            glm::vec3 positive(normal.x >= 0.0f ? boxMax.x : boxMin.x,
+                               normal.y >= 0.0f ? boxMax.y : boxMin.y,
+                               normal.z >= 0.0f ? boxMax.z : boxMin.z);
+            glm::vec3 negative(normal.x >= 0.0f ? boxMin.x : boxMax.x,
+                               normal.y >= 0.0f ? boxMin.y : boxMax.y,
+                               normal.z >= 0.0f ? boxMin.z : boxMax.z);
+            if (glm::dot(normal, positive) + plane.w < 0.0f) return OUTSIDE;
+            if (glm::dot(normal, negative) + plane.w < 0.0f) result = INTERSECTING;
+        }
+        return result;
+    }
+};
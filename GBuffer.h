@@ -1,28 +1,50 @@
 #pragma once
 #include <GL/glew.h>
 #include <iostream>
+#include <string>
+#include "Shader.h"
+
+// GBUFFER_FULL:    world position (RGBA16F), normal (RGBA16F), albedo + shininess (RGBA16F),
+//                  specular (RGB16F), depth-stencil renderbuffer: 34 bytes per pixel.
+// GBUFFER_COMPACT: sampleable depth-stencil texture (positions are reconstructed from it),
+//                  octahedral normal (RG16), albedo + log2 shininess (RGBA8), specular (RGBA8):
+//                  16 bytes per pixel. Shaders reading it are built with COMPACT_GBUFFER.
+// GBUFFER_MATERIAL_ID: depth and normal as in the compact layout, plus a 16-bit index into
+//                  the scene's material table (MaterialBuffer.h): 10 bytes per pixel.
+//                  Shaders are built with COMPACT_GBUFFER and MATERIAL_ID_GBUFFER.
+enum GBufferLayout {
+    GBUFFER_FULL,
+    GBUFFER_COMPACT,
+    GBUFFER_MATERIAL_ID
+};
 
 class GBuffer {
 public:
     enum GBUFFER_TEXTURE_TYPE {
-        GBUFFER_TEXTURE_POSITION,
+        GBUFFER_TEXTURE_POSITION, // Not allocated in the compact layout
         GBUFFER_TEXTURE_NORMAL,
-        GBUFFER_TEXTURE_ALBEDO_SPEC, // diffuse (rgb) + shininess (a)
-        GBUFFER_TEXTURE_SPECULAR, // specular color (rgb)
+        GBUFFER_TEXTURE_ALBEDO_SPEC, // diffuse (rgb) + shininess (a); material index in the material-ID layout
+        GBUFFER_TEXTURE_SPECULAR, // specular color (rgb); not allocated in the material-ID layout
         GBUFFER_TEXTURE_COUNT
     };
 
     GLuint fbo = 0;
-    GLuint textures[GBUFFER_TEXTURE_COUNT];
-    GLuint depthTexture = 0;
-    GLuint depthStencilRB = 0;
+    GLuint textures[GBUFFER_TEXTURE_COUNT] = {};
+    GLuint depthTexture = 0;   // Compact layouts: the depth-stencil attachment itself
+    GLuint depthStencilRB = 0; // Full layout only
     int width, height;
+    GBufferLayout layout;
 
-    GBuffer(int w, int h) : width(w), height(h)
+    GBuffer(int w, int h, GBufferLayout layout = GBUFFER_FULL) : width(w), height(h), layout(layout)
     {
         glGenFramebuffers(1, &fbo);
         glBindFramebuffer(GL_FRAMEBUFFER, fbo);
 
+        if (layout != GBUFFER_FULL) {
+            CreateCompact();
+            return;
+        }
+
         glGenTextures(GBUFFER_TEXTURE_COUNT, textures);
 
         // ===============================
@@ -110,10 +132,29 @@ public:
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
     }
 
+    // Zero names (unallocated attachments) are silently ignored
+    ~GBuffer()
+    {
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteTextures(GBUFFER_TEXTURE_COUNT, textures);
+        glDeleteTextures(1, &depthTexture);
+        glDeleteRenderbuffers(1, &depthStencilRB);
+    }
+    GBuffer(const GBuffer&) = delete;
+    GBuffer& operator=(const GBuffer&) = delete;
+
     // ======================
     // Get memory usage in MB
     // ======================
     float GetMemoryUsageMB() const {
+        // Compact: depth-stencil 4 + normal RG16 4 + albedo RGBA8 4 + specular RGBA8 4 = 16 bytes
+        if (layout == GBUFFER_COMPACT) {
+            return width * height * 16.0f / (1024.0f * 1024.0f);
+        }
+        // Material ID: depth-stencil 4 + normal RG16 4 + material index R16UI 2 = 10 bytes
+        if (layout == GBUFFER_MATERIAL_ID) {
+            return width * height * 10.0f / (1024.0f * 1024.0f);
+        }
         // Calculate bytes per pixel:
         // Position (RGBA16F): 4 channels × 2 bytes = 8 bytes
         // Normal (RGBA16F): 4 channels × 2 bytes = 8 bytes
@@ -159,29 +200,105 @@ public:
     }
 
     // Bind all G-buffer textures to the lighting shader
-    void BindTextures(GLuint shaderID)
+    void BindTextures(Shader& shader)
     {
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textures[GBUFFER_TEXTURE_POSITION]);
-        glUniform1i(glGetUniformLocation(shaderID, "gPosition"), 0);
+        if (layout == GBUFFER_MATERIAL_ID) {
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, textures[GBUFFER_TEXTURE_NORMAL]);
+            shader.SetValue("gNormal", 1);
+
+            glActiveTexture(GL_TEXTURE2);
+            glBindTexture(GL_TEXTURE_2D, textures[GBUFFER_TEXTURE_ALBEDO_SPEC]);
+            shader.SetValue("gMaterial", 2);
+
+            glActiveTexture(GL_TEXTURE4);
+            glBindTexture(GL_TEXTURE_2D, depthTexture);
+            shader.SetValue("gDepth", 4);
+            return;
+        }
+        if (layout == GBUFFER_COMPACT) {
+            glActiveTexture(GL_TEXTURE4);
+            glBindTexture(GL_TEXTURE_2D, depthTexture);
+            shader.SetValue("gDepth", 4);
+        } else {
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, textures[GBUFFER_TEXTURE_POSITION]);
+            shader.SetValue("gPosition", 0);
+        }
 
         glActiveTexture(GL_TEXTURE1);
         glBindTexture(GL_TEXTURE_2D, textures[GBUFFER_TEXTURE_NORMAL]);
-        glUniform1i(glGetUniformLocation(shaderID, "gNormal"), 1);
+        shader.SetValue("gNormal", 1);
 
         glActiveTexture(GL_TEXTURE2);
         glBindTexture(GL_TEXTURE_2D, textures[GBUFFER_TEXTURE_ALBEDO_SPEC]);
-        glUniform1i(glGetUniformLocation(shaderID, "gAlbedoSpec"), 2);
+        shader.SetValue("gAlbedoSpec", 2);
 
         glActiveTexture(GL_TEXTURE3);
         glBindTexture(GL_TEXTURE_2D, textures[GBUFFER_TEXTURE_SPECULAR]);
-        glUniform1i(glGetUniformLocation(shaderID, "gSpecular"), 3);
+        shader.SetValue("gSpecular", 3);
     }
 
+    // Shader source for passes that write or read this layout
+    static std::string WithLayout(const std::string& code, GBufferLayout layout)
+    {
+        if (layout == GBUFFER_MATERIAL_ID) return Shader::WithDefines(code, {"COMPACT_GBUFFER", "MATERIAL_ID_GBUFFER"});
+        return layout == GBUFFER_COMPACT ? Shader::WithDefines(code, {"COMPACT_GBUFFER"}) : code;
+    }
 
-
+    // Attach the G-buffer's depth-stencil to the currently bound framebuffer
+    void AttachDepthStencil() const
+    {
+        if (layout != GBUFFER_FULL) {
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+        } else {
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthStencilRB);
+        }
+    }
 
 private:
+    void CreateCompact()
+    {
+        bool materialId = layout == GBUFFER_MATERIAL_ID;
+        glGenTextures(1, &textures[GBUFFER_TEXTURE_NORMAL]);
+        glGenTextures(1, &textures[GBUFFER_TEXTURE_ALBEDO_SPEC]);
+        if (!materialId) glGenTextures(1, &textures[GBUFFER_TEXTURE_SPECULAR]);
+
+        // Octahedral normal, remapped to [0, 1] (RG16 is always color-renderable, RG16_SNORM is not)
+        CreateTexture(textures[GBUFFER_TEXTURE_NORMAL], GL_RG16, GL_RG, GL_UNSIGNED_SHORT);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, textures[GBUFFER_TEXTURE_NORMAL], 0);
+
+        if (materialId) {
+            // Index into MaterialBuffer
+            CreateTexture(textures[GBUFFER_TEXTURE_ALBEDO_SPEC], GL_R16UI, GL_RED_INTEGER, GL_UNSIGNED_SHORT);
+        } else {
+            // Albedo.rgb + log2(shininess) / 12 in a
+            CreateTexture(textures[GBUFFER_TEXTURE_ALBEDO_SPEC], GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+        }
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, textures[GBUFFER_TEXTURE_ALBEDO_SPEC], 0);
+
+        if (!materialId) {
+            CreateTexture(textures[GBUFFER_TEXTURE_SPECULAR], GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, GL_TEXTURE_2D, textures[GBUFFER_TEXTURE_SPECULAR], 0);
+        }
+
+        // Depth + stencil as a texture, so the lighting passes can reconstruct positions from it
+        glGenTextures(1, &depthTexture);
+        CreateTexture(depthTexture, GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+
+        // Same attachment points as the full layout, minus position (and specular)
+        GLenum attachments[4] = {GL_NONE, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2,
+                                 materialId ? (GLenum)GL_NONE : (GLenum)GL_COLOR_ATTACHMENT3};
+        glDrawBuffers(4, attachments);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "Compact GBuffer incomplete!\n";
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
     void CreateTexture(GLuint tex, GLenum internalFormat, GLenum format, GLenum type)
     {
         glBindTexture(GL_TEXTURE_2D, tex);
@@ -0,0 +1,150 @@
+#include "GeometryArena.h"
+#include "Scene.h"
+
+#include <algorithm>
+#include <cstddef>
+
+GeometryArena::GeometryArena()
+    : builtFor(0), vao(), vbo(), ebo(), drawBuffer(), drawTexture(), vertexCount(0), indexCount(0)
+{
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ebo);
+    glGenBuffers(1, &drawBuffer);
+    glGenTextures(1, &drawTexture);
+
+    glBindVertexArray(vao);
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(ArenaVertex), (void*)offsetof(ArenaVertex, position));
+    glEnableVertexAttribArray(0);
+
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(ArenaVertex), (void*)offsetof(ArenaVertex, normal));
+    glEnableVertexAttribArray(1);
+
+    glVertexAttribIPointer(2, 1, GL_UNSIGNED_INT, sizeof(ArenaVertex), (void*)offsetof(ArenaVertex, instanceIndex));
+    glEnableVertexAttribArray(2);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glBindBuffer(GL_TEXTURE_BUFFER, drawBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, TEXELS_PER_DRAW * sizeof(glm::vec4), nullptr, GL_STATIC_DRAW);
+    glBindTexture(GL_TEXTURE_BUFFER, drawTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, drawBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+GeometryArena::~GeometryArena(){
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vbo);
+    glDeleteBuffers(1, &ebo);
+    glDeleteTextures(1, &drawTexture);
+    glDeleteBuffers(1, &drawBuffer);
+}
+
+void GeometryArena::Build(const Scene& scene){
+    size_t instanceCount = scene.GetInstanceCount();
+
+    // Group instances by mesh so each mesh's geometry is read only once
+    std::vector<std::vector<uint32_t>> meshInstances(scene.GetMeshCount());
+    vertexCount = 0;
+    indexCount = 0;
+    for (size_t i = 0; i < instanceCount; i++) {
+        uint32_t meshIndex = scene.GetInstance(i).mesh;
+        meshInstances[meshIndex].push_back((uint32_t)i);
+        vertexCount += scene.GetMesh(meshIndex).GetVertexCount();
+        indexCount += scene.GetMesh(meshIndex).GetIndexCount();
+    }
+
+    std::vector<ArenaVertex> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<glm::vec4> drawData(instanceCount * TEXELS_PER_DRAW);
+    vertices.reserve(vertexCount);
+    indices.reserve(indexCount);
+    ranges.assign(instanceCount, InstanceRange{});
+
+    std::vector<Vertex> meshVertices;
+    std::vector<uint32_t> meshIndices;
+    for (size_t m = 0; m < meshInstances.size(); m++) {
+        if (meshInstances[m].empty()) continue;
+        const Mesh& mesh = scene.GetMesh(m);
+        const Material& material = scene.GetMaterial(mesh.materialIndex);
+        mesh.ReadGeometry(meshVertices, meshIndices);
+
+        // Shared meshes are copied once per instance: without base-instance draws (GL 4.2)
+        // the per-vertex index is the only way a multi-draw can tell instances apart
+        for (uint32_t i : meshInstances[m]) {
+            // Indices stay mesh-relative; baseVertex offsets them into the arena
+            ranges[i] = {(GLsizei)meshIndices.size(), indices.size(), (GLint)vertices.size()};
+            for (const Vertex& vertex : meshVertices) {
+                vertices.push_back({vertex.position, vertex.normal, i});
+            }
+            indices.insert(indices.end(), meshIndices.begin(), meshIndices.end());
+
+            glm::vec4* texels = &drawData[(size_t)i * TEXELS_PER_DRAW];
+            const glm::mat4& transformation = scene.GetInstance(i).transformation;
+            for (int column = 0; column < 4; column++) {
+                texels[column] = transformation[column];
+            }
+            texels[4] = glm::vec4(material.diffuse, material.shininess);
+            texels[5] = glm::vec4(material.specular, material.opacity);
+            texels[6] = glm::vec4((float)mesh.materialIndex, 0.0f, 0.0f, 0.0f);
+        }
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(ArenaVertex), vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+    glBindVertexArray(0);
+
+    glBindBuffer(GL_TEXTURE_BUFFER, drawBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, std::max(drawData.size(), (size_t)TEXELS_PER_DRAW) * sizeof(glm::vec4),
+                 drawData.empty() ? nullptr : drawData.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    for (DrawList& list : drawLists) {
+        list = DrawList{};
+    }
+    builtFor = scene.GetId();
+}
+
+bool GeometryArena::IsBuiltFor(const Scene& scene) const {
+    return builtFor == scene.GetId();
+}
+
+int GeometryArena::Draw(Shader& shader, Pass pass, const std::vector<uint32_t>& drawOrder){
+    DrawList& list = drawLists[pass];
+
+    // Rebuild the multi-draw arguments only when visibility or the split changed
+    if (list.instances != drawOrder) {
+        list.instances = drawOrder;
+        list.counts.clear();
+        list.offsets.clear();
+        list.baseVertices.clear();
+        for (uint32_t instance : drawOrder) {
+            const InstanceRange& range = ranges[instance];
+            list.counts.push_back(range.indexCount);
+            list.offsets.push_back((const void*)(range.firstIndex * sizeof(uint32_t)));
+            list.baseVertices.push_back(range.baseVertex);
+        }
+    }
+    if (list.instances.empty()) return 0;
+
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, drawTexture);
+    shader.SetValue("drawData", TEXTURE_UNIT);
+
+    glBindVertexArray(vao);
+    glMultiDrawElementsBaseVertex(GL_TRIANGLES, list.counts.data(), GL_UNSIGNED_INT, list.offsets.data(),
+                                  (GLsizei)list.counts.size(), list.baseVertices.data());
+    glBindVertexArray(0);
+    return (int)list.instances.size();
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Shader.h"
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <GL/glew.h>
+
+class Scene;
+
+// Optional merged-geometry backend: all mesh instances packed into one shared vertex/index
+// buffer pair behind a single VAO, and each pass submitted with one
+// glMultiDrawElementsBaseVertex call.
+// GL 3.3 has no multi-draw-indirect, SSBOs or gl_DrawID, so instead:
+//   - every arena vertex carries its instance index (attribute 2), so meshes shared
+//     by several instances are copied once per instance,
+//   - per-instance model matrix and material live in a texture buffer (drawData),
+//     seven RGBA32F texels per instance: model columns 0-3, (diffuse, shininess), (specular, opacity),
+//     (material index, 0, 0, 0) for the material-ID G-buffer,
+//   - the per-pass count/offset/base-vertex arrays stand in for the indirect buffer
+//     and are rebuilt only when the pass's draw list changes.
+// Shaders built with MERGED_GEOMETRY read the model matrix and material from drawData.
+class GeometryArena{
+public:
+    static const int TEXELS_PER_DRAW = 7;
+    static const int TEXTURE_UNIT = 10; // After ClusteredLighting's units
+
+    enum Pass { PASS_DEFERRED, PASS_FORWARD, PASS_COUNT };
+
+    GeometryArena();
+    ~GeometryArena();
+    GeometryArena(const GeometryArena&) = delete;
+    GeometryArena& operator=(const GeometryArena&) = delete;
+
+    // Pack every instance of the scene and upload the per-instance draw data
+    void Build(const Scene& scene);
+    bool IsBuiltFor(const Scene& scene) const; // By Scene::GetId, so a new scene at the same address is not
+
+    // Draw the instances of drawOrder in order with one multi-draw call; returns instances drawn.
+    // The shader must be a MERGED_GEOMETRY variant and already in use.
+    int Draw(Shader& shader, Pass pass, const std::vector<uint32_t>& drawOrder);
+
+    size_t GetVertexCount() const { return vertexCount; }
+    size_t GetIndexCount() const { return indexCount; }
+
+private:
+    struct ArenaVertex {
+        glm::vec3 position;
+        glm::vec3 normal;
+        uint32_t instanceIndex;
+    };
+
+    struct InstanceRange {
+        GLsizei indexCount;
+        size_t firstIndex;
+        GLint baseVertex;
+    };
+
+    // Multi-draw arguments of one pass, kept until its draw list changes
+    struct DrawList {
+        std::vector<uint32_t> instances;
+        std::vector<GLsizei> counts;
+        std::vector<const void*> offsets;
+        std::vector<GLint> baseVertices;
+    };
+
+    uint64_t builtFor; // Scene::GetId of the packed scene, 0 before Build
+    GLuint vao, vbo, ebo;
+    GLuint drawBuffer, drawTexture;
+    size_t vertexCount, indexCount;
+
+    std::vector<InstanceRange> ranges; // Per instance
+    DrawList drawLists[PASS_COUNT];
+};
@@ -0,0 +1,154 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <chrono>
+
+const char* GpuPassName(GpuPass pass){
+    switch (pass) {
+        case GPU_PASS_GBUFFER: return "gbuffer";
+        case GPU_PASS_LIGHTING: return "lighting";
+        case GPU_PASS_FORWARD: return "forward";
+        case GPU_PASS_OVERDRAW: return "overdraw";
+        default: return "unknown";
+    }
+}
+
+GpuProfiler::GpuProfiler(){
+    for (Slot& slot : slots) {
+        glGenQueries(GPU_PASS_COUNT, slot.queries);
+    }
+}
+
+GpuProfiler::~GpuProfiler(){
+    for (Slot& slot : slots) {
+        glDeleteQueries(GPU_PASS_COUNT, slot.queries);
+    }
+}
+
+void GpuProfiler::BeginFrame(size_t frame){
+    Collect();
+    if (!enabled) {
+        recording = false;
+        return;
+    }
+
+    Slot& slot = slots[frame % FRAME_LATENCY];
+    if (recording && currentFrame == frame && slot.open && slot.frame == frame) return;
+
+    // A slot still open here belongs to a frame the GPU has not finished; drop it
+    slot.frame = frame;
+    slot.open = true;
+    slot.lastIssued = -1;
+    std::fill(slot.issued, slot.issued + GPU_PASS_COUNT, false);
+    currentFrame = frame;
+    recording = true;
+}
+
+void GpuProfiler::Begin(GpuPass pass){
+    if (!enabled || !recording) return;
+    Slot& slot = slots[currentFrame % FRAME_LATENCY];
+    glBeginQuery(GL_TIME_ELAPSED, slot.queries[pass]);
+    slot.issued[pass] = true;
+    slot.beginNs[pass] = NowNs();
+    slot.lastIssued = pass;
+}
+
+void GpuProfiler::End(GpuPass pass){
+    if (!enabled || !recording || !slots[currentFrame % FRAME_LATENCY].issued[pass]) return;
+    glEndQuery(GL_TIME_ELAPSED);
+}
+
+void GpuProfiler::EndFrame(){
+    recording = false;
+}
+
+void GpuProfiler::Collect(){
+    // Oldest frame first; once one is not done, the later ones are not either
+    Slot* order[FRAME_LATENCY];
+    int count = 0;
+    for (Slot& slot : slots) {
+        if (slot.open && !(recording && slot.frame == currentFrame)) order[count++] = &slot;
+    }
+    std::sort(order, order + count, [](const Slot* a, const Slot* b){ return a->frame < b->frame; });
+
+    for (int i = 0; i < count; i++) {
+        Slot& slot = *order[i];
+        if (slot.lastIssued >= 0) {
+            GLuint available = 0;
+            glGetQueryObjectuiv(slot.queries[slot.lastIssued], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) break;
+        }
+        slot.open = false;
+        if (slot.lastIssued < 0) continue;
+
+        FrameTimes times;
+        times.frame = slot.frame;
+        uint64_t now = NowNs();
+        for (int pass = 0; pass < GPU_PASS_COUNT; pass++) {
+            if (!slot.issued[pass]) continue;
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(slot.queries[pass], GL_QUERY_RESULT, &nanoseconds);
+            // A scope cannot have taken longer than the wall time since it began (llvmpipe
+            // has been seen to return such values for the first query of a run)
+            if (nanoseconds > now - slot.beginNs[pass]) {
+                rejected++;
+                continue;
+            }
+            times.ms[pass] = nanoseconds / 1.0e6f;
+            times.measured[pass] = true;
+            Push(history[pass], historyNext[pass], times.ms[pass]);
+        }
+        latest = times;
+        hasLatest = true;
+
+        // A frame missing a pass would look cheaper than it was
+        if (!times.Complete()) continue;
+        Push(frameHistory, frameHistoryNext, times.RenderMs());
+        if (completed.size() >= HISTORY_FRAMES) completed.erase(completed.begin()); // Nobody is taking them
+        completed.push_back(times);
+    }
+}
+
+std::vector<GpuProfiler::FrameTimes> GpuProfiler::TakeCompleted(){
+    std::vector<FrameTimes> frames;
+    frames.swap(completed);
+    return frames;
+}
+
+bool GpuProfiler::GetLatest(FrameTimes& times) const {
+    times = latest;
+    return hasLatest;
+}
+
+TimingSummary GpuProfiler::Summary(GpuPass pass) const {
+    return TimingSummary::Compute(history[pass]);
+}
+
+TimingSummary GpuProfiler::FrameSummary() const {
+    return TimingSummary::Compute(frameHistory);
+}
+
+void GpuProfiler::ResetHistory(){
+    for (int pass = 0; pass < GPU_PASS_COUNT; pass++) {
+        history[pass].clear();
+        historyNext[pass] = 0;
+    }
+    frameHistory.clear();
+    frameHistoryNext = 0;
+    completed.clear();
+    rejected = 0;
+}
+
+uint64_t GpuProfiler::NowNs(){
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void GpuProfiler::Push(std::vector<float>& ring, size_t& next, float value){
+    if (ring.size() < HISTORY_FRAMES) {
+        ring.push_back(value);
+    } else {
+        ring[next] = value;
+    }
+    next = (next + 1) % HISTORY_FRAMES;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "Stats.h"
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <GL/glew.h>
+
+// Passes the profiler can time. The overdraw measurement runs in Renderer::Prepare and is
+// counted in the first frame after it
+enum GpuPass { GPU_PASS_GBUFFER, GPU_PASS_LIGHTING, GPU_PASS_FORWARD, GPU_PASS_OVERDRAW, GPU_PASS_COUNT };
+
+const char* GpuPassName(GpuPass pass);
+
+// GPU pass timer built on GL_TIME_ELAPSED queries. Each frame gets a slot in a ring of
+// FRAME_LATENCY query sets; a slot is read back only once GL_QUERY_RESULT_AVAILABLE says
+// its last query is done, so the CPU never waits for the GPU. Frames still in flight when
+// their slot comes round again are dropped. Frames with all render passes measured are
+// kept for the adaptive hybrid controller (TakeCompleted) and in the frame history, and
+// every pass in a history of its last HISTORY_FRAMES measurements, summarized with the
+// same percentiles as the frame times (Stats.h). A result longer than the wall time since
+// its scope began is impossible; it is dropped and counted (GetRejectedCount).
+class GpuProfiler{
+public:
+    static const int FRAME_LATENCY = 4;     // Frames of queries in flight
+    static const size_t HISTORY_FRAMES = 1024;
+
+    // GPU milliseconds of one frame's passes; passes that did not run are 0
+    struct FrameTimes {
+        size_t frame = 0;
+        float ms[GPU_PASS_COUNT] = {};
+        bool measured[GPU_PASS_COUNT] = {};
+        float RenderMs() const { return ms[GPU_PASS_GBUFFER] + ms[GPU_PASS_LIGHTING] + ms[GPU_PASS_FORWARD]; }
+        // All three render passes were read back and passed the sanity check
+        bool Complete() const {
+            return measured[GPU_PASS_GBUFFER] && measured[GPU_PASS_LIGHTING] && measured[GPU_PASS_FORWARD];
+        }
+    };
+
+    GpuProfiler();
+    ~GpuProfiler();
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    // Read back finished slots, then claim the slot of `frame` unless it is already open
+    // (scopes issued before a frame's first pass join it)
+    void BeginFrame(size_t frame);
+    void Begin(GpuPass pass); // Scopes must not nest
+    void End(GpuPass pass);
+    void EndFrame();          // The slot may be read back from now on
+
+    // Read every slot whose results are available, without waiting
+    void Collect();
+
+    // Frames read back since the last call, oldest first; all of them are Complete
+    std::vector<FrameTimes> TakeCompleted();
+    bool GetLatest(FrameTimes& times) const; // False until a frame has been read back
+
+    TimingSummary Summary(GpuPass pass) const; // Over the pass's history
+    TimingSummary FrameSummary() const;        // RenderMs over the complete frames in the history
+    size_t GetSampleCount() const { return frameHistory.size(); }
+    size_t GetRejectedCount() const { return rejected; } // Pass samples failing the sanity check since ResetHistory
+    void ResetHistory(); // Drop history, completed frames and the rejected count (e.g. after warm-up)
+
+    bool enabled = false; // Begin/End are no-ops while off
+
+private:
+    struct Slot {
+        GLuint queries[GPU_PASS_COUNT];
+        size_t frame = 0;
+        bool open = false;                    // Claimed and not read back yet
+        bool issued[GPU_PASS_COUNT] = {};
+        uint64_t beginNs[GPU_PASS_COUNT] = {}; // CPU clock at Begin, to reject impossible results
+        int lastIssued = -1;                  // Queries finish in order, so this one is polled
+    };
+
+    Slot slots[FRAME_LATENCY];
+    bool recording = false; // A BeginFrame slot is open for scopes
+    size_t currentFrame = 0;
+
+    std::vector<FrameTimes> completed;
+    FrameTimes latest;
+    bool hasLatest = false;
+    std::vector<float> history[GPU_PASS_COUNT]; // Ring of the last HISTORY_FRAMES samples per pass
+    std::vector<float> frameHistory;
+    size_t historyNext[GPU_PASS_COUNT] = {};
+    size_t frameHistoryNext = 0;
+    size_t rejected = 0;
+
+    static uint64_t NowNs();
+    static void Push(std::vector<float>& ring, size_t& next, float value);
+};
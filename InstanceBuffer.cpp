@@ -0,0 +1,38 @@
+#include "InstanceBuffer.h"
+
+#include <algorithm>
+
+InstanceBuffer::InstanceBuffer() : buffer(), texture(), capacity(0)
+{
+    glGenBuffers(1, &buffer);
+    glGenTextures(1, &texture);
+
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::mat4), nullptr, GL_STREAM_DRAW);
+
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+InstanceBuffer::~InstanceBuffer(){
+    glDeleteTextures(1, &texture);
+    glDeleteBuffers(1, &buffer);
+}
+
+void InstanceBuffer::Upload(const std::vector<glm::mat4>& transforms){
+    if (transforms.empty()) return;
+
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    capacity = std::max(capacity, transforms.size());
+    glBufferData(GL_TEXTURE_BUFFER, capacity * sizeof(glm::mat4), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, transforms.size() * sizeof(glm::mat4), transforms.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void InstanceBuffer::Bind() const {
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <GL/glew.h>
+
+// Per-instance model matrices for instanced mesh draws, stored in a texture
+// buffer (GL 3.1 core) like LightBuffer. Each matrix is four RGBA32F texels
+// (its columns). A draw sets `instanceBase` to the first matrix of its run and
+// the vertex shaders fetch matrix instanceBase + gl_InstanceID from
+// `uniform samplerBuffer instanceData`.
+class InstanceBuffer{
+public:
+    static const int TEXELS_PER_INSTANCE = 4;
+    static const int TEXTURE_UNIT = 11; // 5: lights, 6-9: tiled/clustered lighting, 10: GeometryArena
+
+    InstanceBuffer();
+    ~InstanceBuffer();
+    InstanceBuffer(const InstanceBuffer&) = delete;
+    InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+    // Replace the GPU contents with this draw's transforms. The old storage is
+    // orphaned so the driver need not wait for draws still reading it.
+    void Upload(const std::vector<glm::mat4>& transforms);
+    void Bind() const;
+
+    size_t GetCapacity() const { return capacity; }
+
+private:
+    GLuint buffer, texture;
+    size_t capacity; // Matrices the buffer storage can hold without reallocation
+};
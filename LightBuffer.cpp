@@ -0,0 +1,62 @@
+#include "LightBuffer.h"
+#include "Scene.h"
+
+#include <iostream>
+
+LightBuffer::LightBuffer() : buffer(), texture(), count(0), capacity(0)
+{
+    glGenBuffers(1, &buffer);
+    glGenTextures(1, &texture);
+
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(GPULight), nullptr, GL_STATIC_DRAW);
+
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+LightBuffer::~LightBuffer(){
+    glDeleteTextures(1, &texture);
+    glDeleteBuffers(1, &buffer);
+}
+
+void LightBuffer::Upload(const std::vector<Light>& lights){
+    GLint maxTexels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+    size_t maxLights = (size_t)maxTexels / TEXELS_PER_LIGHT;
+
+    count = lights.size();
+    if (count > maxLights) {
+        std::cerr << "Warning: " << count << " lights exceed the texture buffer limit of "
+                  << maxLights << ", extra lights are dropped\n";
+        count = maxLights;
+    }
+
+    std::vector<GPULight> packed;
+    packed.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        const Light& light = lights[i];
+        packed.push_back({
+            glm::vec4(light.position, light.radius),
+            glm::vec4(light.color, light.constant),
+            glm::vec4(light.linear, light.quadratic, 0.0f, 0.0f)
+        });
+    }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    if (count > capacity) {
+        capacity = count;
+        glBufferData(GL_TEXTURE_BUFFER, capacity * sizeof(GPULight), packed.data(), GL_STATIC_DRAW);
+    } else if (count > 0) {
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, count * sizeof(GPULight), packed.data());
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightBuffer::Bind() const {
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <GL/glew.h>
+
+struct Light;
+
+// GPU copy of the scene's point lights, stored in a texture buffer (GL 3.1 core)
+// so the light count is limited by GL_MAX_TEXTURE_BUFFER_SIZE instead of the
+// uniform array size. Each light is three tightly packed RGBA32F texels:
+//   [0] position.xyz, radius
+//   [1] color.rgb,    constant
+//   [2] linear, quadratic, 0, 0
+// Shaders read it through `uniform samplerBuffer lightData` with texelFetch.
+class LightBuffer{
+public:
+    static const int TEXELS_PER_LIGHT = 3;
+    static const int TEXTURE_UNIT = 5; // Units 0-4 are used by the G-buffer
+
+    struct GPULight {
+        glm::vec4 positionRadius;
+        glm::vec4 colorConstant;
+        glm::vec4 attenuation;
+    };
+    static_assert(sizeof(GPULight) == TEXELS_PER_LIGHT * 4 * sizeof(float), "GPULight must be tightly packed");
+
+    LightBuffer();
+    ~LightBuffer();
+    LightBuffer(const LightBuffer&) = delete;
+    LightBuffer& operator=(const LightBuffer&) = delete;
+
+    // Replace the GPU contents; call only when the light set changes
+    void Upload(const std::vector<Light>& lights);
+    void Bind() const;
+
+    size_t GetCount() const { return count; }
+    size_t GetCapacity() const { return capacity; }
+
+private:
+    GLuint buffer, texture;
+    size_t count;    // Lights currently uploaded
+    size_t capacity; // Lights the buffer storage can hold without reallocation
+};
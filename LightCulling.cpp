@@ -0,0 +1,42 @@
+#include "LightCulling.h"
+
+#include <algorithm>
+#include <cmath>
+
+TileRect ProjectSphereToTiles(const glm::vec3& viewCenter, float radius, const glm::mat4& projection,
+                              float nearPlane, int width, int height, int tileSize){
+    int tilesX = (width + tileSize - 1) / tileSize;
+    int tilesY = (height + tileSize - 1) / tileSize;
+    TileRect rect{0, 0, tilesX - 1, tilesY - 1};
+
+    float minDepth = -viewCenter.z - radius;
+    float maxDepth = -viewCenter.z + radius;
+    if (maxDepth < nearPlane) {
+        return TileRect{0, 0, -1, -1}; // Entirely behind the camera
+    }
+    if (minDepth <= nearPlane) {
+        return rect; // Straddles the near plane
+    }
+
+    // Project the corners of the sphere's view-space bounding box
+    float minX = 1.0f, maxX = -1.0f, minY = 1.0f, maxY = -1.0f;
+    for (int c = 0; c < 8; c++){
+        glm::vec3 corner = viewCenter + glm::vec3((c & 1) ? radius : -radius,
+                                                  (c & 2) ? radius : -radius,
+                                                  (c & 4) ? radius : -radius);
+        glm::vec4 clip = projection * glm::vec4(corner, 1.0f);
+        float x = clip.x / clip.w;
+        float y = clip.y / clip.w;
+        minX = std::min(minX, x); maxX = std::max(maxX, x);
+        minY = std::min(minY, y); maxY = std::max(maxY, y);
+    }
+    if (maxX < -1.0f || minX > 1.0f || maxY < -1.0f || minY > 1.0f) {
+        return TileRect{0, 0, -1, -1}; // Off screen
+    }
+
+    rect.x0 = std::max(0, (int)std::floor((minX * 0.5f + 0.5f) * width / tileSize));
+    rect.x1 = std::min(tilesX - 1, (int)std::floor((maxX * 0.5f + 0.5f) * width / tileSize));
+    rect.y0 = std::max(0, (int)std::floor((minY * 0.5f + 0.5f) * height / tileSize));
+    rect.y1 = std::min(tilesY - 1, (int)std::floor((maxY * 0.5f + 0.5f) * height / tileSize));
+    return rect;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// Screen-space binning helpers shared by tiled deferred and clustered forward lighting
+
+// Inclusive range of screen tiles covered by a light (x1 < x0 means none)
+struct TileRect {
+    int x0, y0, x1, y1;
+    bool IsEmpty() const { return x1 < x0 || y1 < y0; }
+};
+
+// Conservative rect of tileSize x tileSize pixel tiles covered by a view-space sphere
+// in a width x height viewport. Spheres that reach the near plane cover the whole grid.
+TileRect ProjectSphereToTiles(const glm::vec3& viewCenter, float radius, const glm::mat4& projection,
+                              float nearPlane, int width, int height, int tileSize);
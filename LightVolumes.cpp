@@ -0,0 +1,214 @@
+#include "LightVolumes.h"
+#include "Scene.h"
+#include "Renderer.h"
+
+#include <vector>
+#include <cmath>
+#include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <iostream>
+
+LightVolumes::LightVolumes(int width, int height, const GBuffer& gbuffer)
+    : width(width), height(height),
+      ambientShader(ReadTextFile("lighting_vert.glsl"),
+                    GBuffer::WithLayout(ReadTextFile("light_ambient_frag.glsl"), gbuffer.layout)),
+      volumeShader(ReadTextFile("light_volume_vert.glsl"),
+                   GBuffer::WithLayout(ReadTextFile("light_volume_frag.glsl"), gbuffer.layout)),
+      resolveShader(ReadTextFile("lighting_vert.glsl"), ReadTextFile("tonemap_frag.glsl")),
+      accumFBO(), accumTexture(), depthStencilCopy(), sphereVAO(), sphereVBO(), sphereEBO(), sphereIndexCount(0)
+{
+    // HDR accumulation target, sharing the G-buffer's depth/stencil so the
+    // geometry stencil mask and scene depth are available to the light volumes
+    glGenFramebuffers(1, &accumFBO);
+    glGenTextures(1, &accumTexture);
+    glBindTexture(GL_TEXTURE_2D, accumTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, accumFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, accumTexture, 0);
+    if (gbuffer.layout != GBUFFER_FULL) {
+        // Testing against a depth texture the shader also samples would be a feedback loop
+        glGenRenderbuffers(1, &depthStencilCopy);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthStencilCopy);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthStencilCopy);
+    } else {
+        gbuffer.AttachDepthStencil();
+    }
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Light volume FBO incomplete!\n";
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    CreateSphere();
+}
+
+LightVolumes::~LightVolumes(){
+    // depthStencilCopy is zero with the full G-buffer, which glDeleteRenderbuffers ignores
+    glDeleteFramebuffers(1, &accumFBO);
+    glDeleteTextures(1, &accumTexture);
+    glDeleteRenderbuffers(1, &depthStencilCopy);
+    glDeleteVertexArrays(1, &sphereVAO);
+    glDeleteBuffers(1, &sphereVBO);
+    glDeleteBuffers(1, &sphereEBO);
+}
+
+void LightVolumes::CreateSphere(){
+    // UV sphere with vertices on the unit sphere, counter-clockwise from outside
+    std::vector<glm::vec3> positions;
+    for (int ring = 0; ring <= SPHERE_RINGS; ++ring) {
+        float phi = glm::pi<float>() * ring / SPHERE_RINGS;
+        for (int sector = 0; sector <= SPHERE_SECTORS; ++sector) {
+            float theta = 2.0f * glm::pi<float>() * sector / SPHERE_SECTORS;
+            positions.push_back(glm::vec3(std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta)));
+        }
+    }
+
+    std::vector<uint32_t> indices;
+    auto addTriangle = [&](uint32_t a, uint32_t b, uint32_t c) {
+        glm::vec3 normal = glm::cross(positions[b] - positions[a], positions[c] - positions[a]);
+        if (glm::length(normal) < 1e-6f) return; // Degenerate (pole)
+        if (glm::dot(normal, positions[a] + positions[b] + positions[c]) < 0.0f) std::swap(b, c);
+        indices.insert(indices.end(), {a, b, c});
+    };
+    for (int ring = 0; ring < SPHERE_RINGS; ++ring) {
+        for (int sector = 0; sector < SPHERE_SECTORS; ++sector) {
+            uint32_t i0 = ring * (SPHERE_SECTORS + 1) + sector;
+            uint32_t i1 = i0 + SPHERE_SECTORS + 1;
+            addTriangle(i0, i1, i0 + 1);
+            addTriangle(i0 + 1, i1, i1 + 1);
+        }
+    }
+
+    // The faces cut inside the unit sphere; scale so the closest face plane
+    // is at distance 1 and the mesh fully encloses the light's radius
+    float minPlaneDistance = 1.0f;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        const glm::vec3& a = positions[indices[i]];
+        glm::vec3 normal = glm::normalize(glm::cross(positions[indices[i + 1]] - a, positions[indices[i + 2]] - a));
+        minPlaneDistance = std::min(minPlaneDistance, glm::dot(normal, a));
+    }
+    for (glm::vec3& position : positions) {
+        position /= minPlaneDistance;
+    }
+    sphereIndexCount = (GLsizei)indices.size();
+
+    glGenVertexArrays(1, &sphereVAO);
+    glGenBuffers(1, &sphereVBO);
+    glGenBuffers(1, &sphereEBO);
+
+    glBindVertexArray(sphereVAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, sphereVBO);
+    glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void LightVolumes::MarkGeometry() const{
+    glEnable(GL_STENCIL_TEST);
+    glStencilMask(0xFF);
+    glStencilFunc(GL_ALWAYS, 1, 0xFF);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+}
+
+void LightVolumes::SetConstants(float ambientStrength, const glm::vec3& ambientColor, float exposure){
+    ambientShader.Use();
+    ambientShader.SetValue("ambientStrength", ambientStrength);
+    ambientShader.SetValue("ambientColor", ambientColor);
+
+    resolveShader.Use();
+    resolveShader.SetValue("exposure", exposure);
+}
+
+void LightVolumes::Render(const Scene& scene, GBuffer& gbuffer, const Quad& quad,
+                          const glm::mat4& view, const glm::mat4& projection,
+                          const glm::vec3& viewPos, GLuint targetFBO){
+    if (depthStencilCopy) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, gbuffer.GetFBO());
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, accumFBO);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height,
+                          GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT, GL_NEAREST);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, accumFBO);
+    glViewport(0, 0, width, height);
+    const float black[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    glClearBufferfv(GL_COLOR, 0, black);
+
+    // Only pixels covered by G-buffer geometry are shaded
+    glEnable(GL_STENCIL_TEST);
+    glStencilMask(0x00);
+    glStencilFunc(GL_EQUAL, 1, 0xFF);
+
+    // Ambient (overwrites the cleared target, background stays zero)
+    gbuffer.BindForReading();
+    ambientShader.Use();
+    if (gbuffer.layout == GBUFFER_MATERIAL_ID) {
+        ambientShader.SetValue("gMaterial", 2);
+        scene.SetMaterials(ambientShader);
+    } else {
+        ambientShader.SetValue("gAlbedoSpec", 2);
+    }
+    quad.Draw();
+
+    // One back-facing sphere per light: GL_GEQUAL keeps only surfaces in front of the
+    // far side of the volume, depth clamp keeps volumes crossing the far plane intact,
+    // and drawing back faces keeps the volume visible when the camera is inside it
+    if (scene.GetLightCount() > 0) {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+        glEnable(GL_DEPTH_TEST);
+        glDepthFunc(GL_GEQUAL);
+        glDepthMask(GL_FALSE);
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_FRONT);
+        glEnable(GL_DEPTH_CLAMP);
+
+        volumeShader.Use();
+        volumeShader.SetValue("view", view);
+        volumeShader.SetValue("projection", projection);
+        volumeShader.SetValue("viewPos", viewPos);
+        scene.SetLights(volumeShader);
+        gbuffer.BindTextures(volumeShader);
+        if (gbuffer.layout != GBUFFER_FULL) {
+            volumeShader.SetValue("inverseViewProjection", glm::inverse(projection * view));
+        }
+        if (gbuffer.layout == GBUFFER_MATERIAL_ID) {
+            scene.SetMaterials(volumeShader);
+        }
+
+        glBindVertexArray(sphereVAO);
+        glDrawElementsInstanced(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_INT, nullptr, (GLsizei)scene.GetLightCount());
+        glBindVertexArray(0);
+
+        glDisable(GL_DEPTH_CLAMP);
+        glCullFace(GL_BACK);
+        glDisable(GL_CULL_FACE);
+        glDepthMask(GL_TRUE);
+        glDepthFunc(GL_LESS);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+    }
+
+    glStencilMask(0xFF);
+    glDisable(GL_STENCIL_TEST);
+
+    // Tone map the accumulated radiance
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+    glViewport(0, 0, width, height);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, accumTexture);
+    resolveShader.Use();
+    resolveShader.SetValue("hdrBuffer", 0);
+    quad.Draw();
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Shader.h"
+#include "GBuffer.h"
+#include "Quad.h"
+
+#include <glm/glm.hpp>
+#include <GL/glew.h>
+
+class Scene;
+
+// Light-volume deferred lighting:
+//   1. The G-buffer pass writes stencil = 1 wherever geometry was drawn (MarkGeometry).
+//   2. An HDR accumulation target shares the G-buffer's depth/stencil (the compact layout
+//      samples its depth texture in the volume shader, so it gets a copy instead). An ambient pass
+//      and then one instanced draw of a bounding sphere per light are rasterized into it
+//      with additive blending. Stencil == 1 rejects background pixels before shading,
+//      and back faces drawn with GL_GEQUAL depth reject pixels behind each light's volume;
+//      the shader discards the remaining pixels in front of the volume by distance.
+//   3. A fullscreen resolve tone maps the accumulated radiance into the target framebuffer
+//      (tone mapping is non-linear, so it cannot be applied per light).
+class LightVolumes{
+public:
+    static const int SPHERE_RINGS = 8;
+    static const int SPHERE_SECTORS = 12;
+
+    LightVolumes(int width, int height, const GBuffer& gbuffer);
+    ~LightVolumes();
+    LightVolumes(const LightVolumes&) = delete;
+    LightVolumes& operator=(const LightVolumes&) = delete;
+
+    // Enable stencil writes for the G-buffer pass; call after clearing the G-buffer
+    void MarkGeometry() const;
+
+    // Accumulate ambient + every light into the HDR target, then tone map into targetFBO.
+    // Expects depth testing to be disabled; leaves it disabled.
+    void Render(const Scene& scene, GBuffer& gbuffer, const Quad& quad,
+                const glm::mat4& view, const glm::mat4& projection,
+                const glm::vec3& viewPos, GLuint targetFBO);
+
+    // Set the per-scene constants (ambient, exposure) on the volume shaders
+    void SetConstants(float ambientStrength, const glm::vec3& ambientColor, float exposure);
+
+private:
+    void CreateSphere();
+
+    int width, height;
+
+    Shader ambientShader;
+    Shader volumeShader;
+    Shader resolveShader;
+
+    GLuint accumFBO, accumTexture;
+    GLuint depthStencilCopy; // Compact G-buffer only: blitted from the G-buffer every frame
+    GLuint sphereVAO, sphereVBO, sphereEBO;
+    GLsizei sphereIndexCount;
+};
@@ -0,0 +1,62 @@
+#include "MaterialBuffer.h"
+#include "Scene.h"
+
+#include <algorithm>
+#include <iostream>
+
+MaterialBuffer::MaterialBuffer() : buffer(), texture(), count(0), capacity(0)
+{
+    glGenBuffers(1, &buffer);
+    glGenTextures(1, &texture);
+
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(GPUMaterial), nullptr, GL_STATIC_DRAW);
+
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+MaterialBuffer::~MaterialBuffer(){
+    glDeleteTextures(1, &texture);
+    glDeleteBuffers(1, &buffer);
+}
+
+void MaterialBuffer::Upload(const std::vector<Material>& materials){
+    GLint maxTexels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+    size_t maxMaterials = std::min((size_t)maxTexels / TEXELS_PER_MATERIAL, MAX_MATERIALS);
+
+    count = materials.size();
+    if (count > maxMaterials) {
+        std::cerr << "Warning: " << count << " materials exceed the material table limit of "
+                  << maxMaterials << ", the material-ID G-buffer will show wrong materials\n";
+        count = maxMaterials;
+    }
+
+    std::vector<GPUMaterial> packed;
+    packed.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        const Material& material = materials[i];
+        packed.push_back({
+            glm::vec4(material.diffuse, material.shininess),
+            glm::vec4(material.specular, material.opacity)
+        });
+    }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    if (count > capacity) {
+        capacity = count;
+        glBufferData(GL_TEXTURE_BUFFER, capacity * sizeof(GPUMaterial), packed.data(), GL_STATIC_DRAW);
+    } else if (count > 0) {
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, count * sizeof(GPUMaterial), packed.data());
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void MaterialBuffer::Bind() const {
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <GL/glew.h>
+
+struct Material;
+
+// GPU table of the scene's materials for the material-ID G-buffer (GBUFFER_MATERIAL_ID),
+// stored in a texture buffer like LightBuffer. Each material is two RGBA32F texels:
+//   [0] diffuse.rgb,  shininess
+//   [1] specular.rgb, opacity
+// The G-buffer keeps only a 16-bit index into it; the lighting shaders read it through
+// `uniform samplerBuffer materialData` with texelFetch.
+class MaterialBuffer{
+public:
+    static const int TEXELS_PER_MATERIAL = 2;
+    static const int TEXTURE_UNIT = 12; // After InstanceBuffer::TEXTURE_UNIT
+    static const size_t MAX_MATERIALS = 65536; // R16UI G-buffer index
+
+    struct GPUMaterial {
+        glm::vec4 diffuseShininess;
+        glm::vec4 specularOpacity;
+    };
+    static_assert(sizeof(GPUMaterial) == TEXELS_PER_MATERIAL * 4 * sizeof(float), "GPUMaterial must be tightly packed");
+
+    MaterialBuffer();
+    ~MaterialBuffer();
+    MaterialBuffer(const MaterialBuffer&) = delete;
+    MaterialBuffer& operator=(const MaterialBuffer&) = delete;
+
+    // Replace the GPU contents; call only when the material set changes
+    void Upload(const std::vector<Material>& materials);
+    void Bind() const;
+
+    size_t GetCount() const { return count; }
+
+private:
+    GLuint buffer, texture;
+    size_t count;    // Materials currently uploaded
+    size_t capacity; // Materials the buffer storage can hold without reallocation
+};
@@ -1,12 +1,96 @@
 #include "Mesh.h"
 
 #include <GL/glew.h>
+#include <algorithm>
+#include <cmath>
+#include <utility>
 
-Mesh::Mesh(std::vector<Vertex> vertices, std::vector<uint32_t> indices, size_t materialIndex)
-    : vertices(vertices), indices(indices), vao(), vbo(), ebo(), transformation(), 
-      materialIndex(materialIndex), triangleCount(indices.size() / 3), center(0.0f),
-      bboxMin(0.0f), bboxMax(0.0f)
+// Largest vertex count whose indices fit GL_UNSIGNED_SHORT
+static const size_t MAX_SHORT_INDEXED_VERTICES = 65536;
+
+// One signed normalized 10-bit component, two's complement in the low 10 bits
+static uint32_t PackSnorm10(float value){
+    int quantized = (int)std::lround(std::min(std::max(value, -1.0f), 1.0f) * 511.0f);
+    return (uint32_t)quantized & 0x3FFu;
+}
+
+static float UnpackSnorm10(uint32_t bits){
+    int value = (int)(bits & 0x3FFu);
+    if (value & 0x200) value -= 0x400; // Sign-extend
+    return std::max((float)value / 511.0f, -1.0f);
+}
+
+Mesh::Mesh(std::vector<Vertex> vertices, std::vector<uint32_t> indices, size_t materialIndex, bool keepCpuGeometry,
+           VertexFormat format)
+    : materialIndex(materialIndex), triangleCount(indices.size() / 3), center(0.0f),
+      bboxMin(0.0f), bboxMax(0.0f), vertices(std::move(vertices)), indices(std::move(indices)),
+      vertexCount(this->vertices.size()), indexCount(this->indices.size()), lodIndexCount(0), format(format),
+      indexType(GL_UNSIGNED_INT), positionOffset(0.0f), positionScale(1.0f), vao(), vbo(), ebo()
+{
+    if (format == VERTEX_COMPRESSED) UploadCompressed(this->vertices.data(), this->indices.data(), nullptr);
+    else Upload(this->vertices.data(), this->indices.data(), nullptr);
+
+    if (!keepCpuGeometry) {
+        ReleaseCpuGeometry();
+    }
+}
+
+Mesh::Mesh(MeshData&& data, bool keepCpuGeometry, VertexFormat format)
+    : materialIndex(data.materialIndex), triangleCount(data.indices.size() / 3),
+      center((data.bboxMin + data.bboxMax) * 0.5f), bboxMin(data.bboxMin), bboxMax(data.bboxMax),
+      vertices(std::move(data.vertices)), indices(std::move(data.indices)), lodIndices(std::move(data.lodIndices)),
+      lods(std::move(data.lods)), vertexCount(vertices.size()), indexCount(indices.size()),
+      lodIndexCount(lodIndices.size()), format(format), indexType(GL_UNSIGNED_INT),
+      positionOffset(0.0f), positionScale(1.0f), vao(), vbo(), ebo()
 {
+    if (format == VERTEX_COMPRESSED) UploadCompressed(vertices.data(), indices.data(), lodIndices.data());
+    else Upload(vertices.data(), indices.data(), lodIndices.data());
+
+    if (!keepCpuGeometry) {
+        ReleaseCpuGeometry();
+    }
+}
+
+Mesh::Mesh(const Vertex* vertexData, size_t vertexCount, const uint32_t* indexData, size_t indexCount,
+           size_t materialIndex, bool keepCpuGeometry, VertexFormat format, const MeshLods& meshLods)
+    : materialIndex(materialIndex), triangleCount(indexCount / 3), center(0.0f),
+      bboxMin(0.0f), bboxMax(0.0f), lods(meshLods.levels), vertexCount(vertexCount), indexCount(indexCount),
+      lodIndexCount(meshLods.indexCount), format(format),
+      indexType(GL_UNSIGNED_INT), positionOffset(0.0f), positionScale(1.0f), vao(), vbo(), ebo()
+{
+    if (format == VERTEX_COMPRESSED) UploadCompressed(vertexData, indexData, meshLods.indices);
+    else Upload(vertexData, indexData, meshLods.indices);
+
+    if (keepCpuGeometry) {
+        vertices.assign(vertexData, vertexData + vertexCount);
+        indices.assign(indexData, indexData + indexCount);
+        if (lodIndexCount > 0) lodIndices.assign(meshLods.indices, meshLods.indices + lodIndexCount);
+    }
+}
+
+void Mesh::UploadIndices(const uint32_t* indexData, const uint32_t* lodIndexData, bool shortIndices){
+    indexType = shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    size_t indexSize = shortIndices ? sizeof(uint16_t) : sizeof(uint32_t);
+
+    // The element buffer binding is VAO state, so it stays bound for Draw
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (indexCount + lodIndexCount) * indexSize, nullptr, GL_STATIC_DRAW);
+    const uint32_t* parts[2] = {indexData, lodIndexData};
+    size_t counts[2] = {indexCount, lodIndexCount};
+    size_t offset = 0;
+    for (int part = 0; part < 2; part++) {
+        if (counts[part] == 0) continue;
+        if (shortIndices) {
+            std::vector<uint16_t> narrowed(parts[part], parts[part] + counts[part]);
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset, counts[part] * indexSize, narrowed.data());
+        } else {
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset, counts[part] * indexSize, parts[part]);
+        }
+        offset += counts[part] * indexSize;
+    }
+}
+
+void Mesh::Upload(const Vertex* vertexData, const uint32_t* indexData, const uint32_t* lodIndexData){
     glGenBuffers(1, &vbo);
     glGenBuffers(1, &ebo);
     glGenVertexArrays(1, &vao);
@@ -14,10 +98,9 @@ Mesh::Mesh(std::vector<Vertex> vertices, std::vector<uint32_t> indices, size_t m
     glBindVertexArray(vao);
 
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), vertexData, GL_STATIC_DRAW);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(glm::uint32_t), indices.data(), GL_STATIC_DRAW);
+    UploadIndices(indexData, lodIndexData, false);
 
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
     glEnableVertexAttribArray(0);
@@ -25,13 +108,187 @@ Mesh::Mesh(std::vector<Vertex> vertices, std::vector<uint32_t> indices, size_t m
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
     glEnableVertexAttribArray(1);
 
+    glBindVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void Mesh::UploadCompressed(const Vertex* vertexData, const uint32_t* indexData, const uint32_t* lodIndexData){
+    // Quantize over the bounds of the data itself (the same box as bboxMin/bboxMax),
+    // so the cache and import paths agree without passing the bounds in
+    glm::vec3 minPosition(0.0f), maxPosition(0.0f);
+    if (vertexCount > 0) {
+        minPosition = maxPosition = vertexData[0].position;
+        for (size_t i = 1; i < vertexCount; i++) {
+            minPosition = glm::min(minPosition, vertexData[i].position);
+            maxPosition = glm::max(maxPosition, vertexData[i].position);
+        }
+    }
+    positionOffset = minPosition;
+    positionScale = maxPosition - minPosition;
+
+    std::vector<CompressedVertex> packed(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++) {
+        glm::vec3 position = vertexData[i].position;
+        for (int axis = 0; axis < 3; axis++) {
+            float extent = positionScale[axis];
+            float t = extent > 0.0f ? (position[axis] - minPosition[axis]) / extent : 0.0f;
+            packed[i].position[axis] = (uint16_t)std::lround(std::min(std::max(t, 0.0f), 1.0f) * 65535.0f);
+        }
+        packed[i].position[3] = 0;
+        glm::vec3 normal = vertexData[i].normal;
+        packed[i].normal = PackSnorm10(normal.x) | (PackSnorm10(normal.y) << 10) | (PackSnorm10(normal.z) << 20);
+    }
+
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ebo);
+    glGenVertexArrays(1, &vao);
+
+    glBindVertexArray(vao);
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(CompressedVertex), packed.data(), GL_STATIC_DRAW);
+
+    UploadIndices(indexData, lodIndexData, vertexCount <= MAX_SHORT_INDEXED_VERTICES);
+
+    glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(CompressedVertex),
+                          (void*)offsetof(CompressedVertex, position));
+    glEnableVertexAttribArray(0);
+
+    // Packed types must be read with size 4; the shaders only use xyz
+    glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(CompressedVertex),
+                          (void*)offsetof(CompressedVertex, normal));
+    glEnableVertexAttribArray(1);
+
     glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+size_t Mesh::GetGpuBytes() const {
+    size_t vertexSize = format == VERTEX_COMPRESSED ? sizeof(CompressedVertex) : sizeof(Vertex);
+    size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    return vertexCount * vertexSize + (indexCount + lodIndexCount) * indexSize;
+}
+
+Mesh::~Mesh(){
+    DeleteBuffers();
+}
+
+Mesh::Mesh(Mesh&& other) noexcept
+    : materialIndex(other.materialIndex), triangleCount(other.triangleCount), center(other.center),
+      bboxMin(other.bboxMin), bboxMax(other.bboxMax),
+      vertices(std::move(other.vertices)), indices(std::move(other.indices)),
+      lodIndices(std::move(other.lodIndices)), lods(std::move(other.lods)),
+      vertexCount(other.vertexCount), indexCount(other.indexCount), lodIndexCount(other.lodIndexCount), format(other.format),
+      indexType(other.indexType), positionOffset(other.positionOffset), positionScale(other.positionScale),
+      vao(other.vao), vbo(other.vbo), ebo(other.ebo)
+{
+    other.vao = other.vbo = other.ebo = 0;
+}
+
+Mesh& Mesh::operator=(Mesh&& other) noexcept {
+    if (this != &other) {
+        DeleteBuffers();
+        materialIndex = other.materialIndex;
+        triangleCount = other.triangleCount;
+        center = other.center;
+        bboxMin = other.bboxMin;
+        bboxMax = other.bboxMax;
+        vertices = std::move(other.vertices);
+        indices = std::move(other.indices);
+        lodIndices = std::move(other.lodIndices);
+        lods = std::move(other.lods);
+        vertexCount = other.vertexCount;
+        indexCount = other.indexCount;
+        lodIndexCount = other.lodIndexCount;
+        format = other.format;
+        indexType = other.indexType;
+        positionOffset = other.positionOffset;
+        positionScale = other.positionScale;
+        vao = other.vao;
+        vbo = other.vbo;
+        ebo = other.ebo;
+        other.vao = other.vbo = other.ebo = 0;
+    }
+    return *this;
+}
+
+void Mesh::DeleteBuffers(){
+    // Zero names are silently ignored, so moved-from meshes delete nothing
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vbo);
+    glDeleteBuffers(1, &ebo);
+    vao = vbo = ebo = 0;
+}
+
+void Mesh::ReleaseCpuGeometry(){
+    // swap with empty vectors: clear() alone keeps the capacity
+    std::vector<Vertex>().swap(vertices);
+    std::vector<uint32_t>().swap(indices);
+    std::vector<uint32_t>().swap(lodIndices);
+}
+
+void Mesh::ReadGeometry(std::vector<Vertex>& outVertices, std::vector<uint32_t>& outIndices) const {
+    if (HasCpuGeometry()) {
+        outVertices = vertices;
+        outIndices = indices;
+        return;
+    }
+
+    // GL_COPY_READ_BUFFER avoids disturbing the bound VAO's element buffer
+    outVertices.resize(vertexCount);
+    outIndices.resize(indexCount);
+    glBindBuffer(GL_COPY_READ_BUFFER, vbo);
+    if (format == VERTEX_COMPRESSED) {
+        std::vector<CompressedVertex> packed(vertexCount);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, vertexCount * sizeof(CompressedVertex), packed.data());
+        for (size_t i = 0; i < vertexCount; i++) {
+            glm::vec3 t(packed[i].position[0], packed[i].position[1], packed[i].position[2]);
+            outVertices[i].position = positionOffset + t / 65535.0f * positionScale;
+            uint32_t normal = packed[i].normal;
+            outVertices[i].normal = glm::vec3(UnpackSnorm10(normal), UnpackSnorm10(normal >> 10), UnpackSnorm10(normal >> 20));
+        }
+    } else {
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, vertexCount * sizeof(Vertex), outVertices.data());
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    ReadIndices(0, indexCount, outIndices.data());
+}
+
+void Mesh::ReadLodIndices(std::vector<uint32_t>& outIndices) const {
+    if (HasCpuGeometry()) {
+        outIndices = lodIndices;
+        return;
+    }
+    outIndices.resize(lodIndexCount);
+    ReadIndices(indexCount, lodIndexCount, outIndices.data());
+}
+
+void Mesh::ReadIndices(size_t first, size_t count, uint32_t* out) const {
+    if (count == 0) return;
+    glBindBuffer(GL_COPY_READ_BUFFER, ebo);
+    if (indexType == GL_UNSIGNED_SHORT) {
+        std::vector<uint16_t> shortIndices(count);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, first * sizeof(uint16_t), count * sizeof(uint16_t), shortIndices.data());
+        std::copy(shortIndices.begin(), shortIndices.end(), out);
+    } else {
+        glGetBufferSubData(GL_COPY_READ_BUFFER, first * sizeof(uint32_t), count * sizeof(uint32_t), out);
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
 }
 
 void Mesh::Draw() const {
     glBindVertexArray(vao);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, nullptr);
-}
\ No newline at end of file
+    glDrawElements(GL_TRIANGLES, (GLsizei)indexCount, indexType, nullptr);
+}
+
+void Mesh::DrawInstanced(int instanceCount, int lod) const {
+    size_t first = 0, count = indexCount;
+    if (lod > 0) {
+        const MeshLod& level = lods[lod - 1];
+        first = indexCount + level.firstIndex;
+        count = level.indexCount;
+    }
+    size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    glBindVertexArray(vao);
+    glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)count, indexType, (void*)(first * indexSize), instanceCount);
+}
@@ -2,29 +2,137 @@
 
 #include <glm/glm.hpp>
 #include <vector>
+#include <cstdint>
 
 struct Vertex{
     glm::vec3 position;
     glm::vec3 normal;
 };
 
+// GPU vertex layout chosen at upload time
+enum VertexFormat {
+    VERTEX_FLOAT,      // Vertex as is (24 bytes), 32-bit indices
+    VERTEX_COMPRESSED  // CompressedVertex (12 bytes), 16-bit indices when the mesh has <= 65536 vertices
+};
+
+// Compressed GPU vertex. Positions are quantized to 16 bits per axis over the mesh
+// bounds and read as normalized unsigned shorts; the vertex shaders rebuild them
+// from positionOffset/positionScale (GetPositionOffset/GetPositionScale).
+// Normals are GL_INT_2_10_10_10_REV, which the attribute fetch decodes for free.
+struct CompressedVertex{
+    uint16_t position[4]; // xyz, w is padding to keep the normal 4-byte aligned
+    uint32_t normal;      // x: bits 0-9, y: 10-19, z: 20-29 (signed normalized)
+};
+
+// A coarser index list over the same vertices (level 0 is the mesh's own index list)
+struct MeshLod{
+    uint32_t firstIndex; // Offset into the LOD index list
+    uint32_t indexCount;
+    float error;         // Upper bound on the geometric error vs. level 0, local units
+};
+
+// Coarser levels uploaded behind level 0 in the same element buffer
+struct MeshLods{
+    const uint32_t* indices = nullptr; // Indices of all levels back to back
+    size_t indexCount = 0;
+    std::vector<MeshLod> levels;       // Finest first
+};
+
+// CPU-side geometry of one mesh, produced by the import workers without touching GL
+struct MeshData{
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<uint32_t> lodIndices; // Coarser levels (MeshSimplifier), ranges in lods
+    std::vector<MeshLod> lods;
+    size_t materialIndex = 0;
+    glm::vec3 bboxMin{0.0f}; // Local-space bounds
+    glm::vec3 bboxMax{0.0f};
+};
+
+// Geometry of one aiMesh, uploaded once and shared by every node that references it.
+// Placement in the scene lives in MeshInstance (Scene.h).
+// Owns its VAO/VBO/EBO: move-only, and the GL objects are deleted with the mesh.
 class Mesh{
 public:
-    Mesh(std::vector<Vertex> vertices, std::vector<uint32_t> indices, size_t materialIndex = 0);
+    // Uploads the geometry in the given format. The CPU arrays are freed after the upload
+    // unless keepCpuGeometry is set (ReadGeometry can still fetch them back from the GPU).
+    Mesh(std::vector<Vertex> vertices, std::vector<uint32_t> indices, size_t materialIndex = 0,
+         bool keepCpuGeometry = false, VertexFormat format = VERTEX_FLOAT);
+    // Takes over converted import data, including its bounds
+    explicit Mesh(MeshData&& data, bool keepCpuGeometry = false, VertexFormat format = VERTEX_FLOAT);
+    // Uploads straight from caller-owned memory (e.g. a mapped SceneCache file), copying
+    // it to the CPU only if keepCpuGeometry is set
+    Mesh(const Vertex* vertexData, size_t vertexCount, const uint32_t* indexData, size_t indexCount,
+         size_t materialIndex = 0, bool keepCpuGeometry = false, VertexFormat format = VERTEX_FLOAT,
+         const MeshLods& lods = MeshLods());
+    ~Mesh();
+
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+    Mesh(Mesh&& other) noexcept;
+    Mesh& operator=(Mesh&& other) noexcept;
+
     void Draw() const;
+    // Draw instanceCount copies of one level of detail; shaders tell them apart by gl_InstanceID
+    void DrawInstanced(int instanceCount, int lod = 0) const;
+
+    // Level 0 plus the generated coarser levels
+    int GetLodCount() const { return 1 + (int)lods.size(); }
+    const std::vector<MeshLod>& GetLods() const { return lods; }
+    size_t GetLodTriangleCount(int lod) const { return lod == 0 ? triangleCount : lods[lod - 1].indexCount / 3; }
+    float GetLodError(int lod) const { return lod == 0 ? 0.0f : lods[lod - 1].error; }
+
+    size_t GetVertexCount() const { return vertexCount; }
+    size_t GetIndexCount() const { return indexCount; }
+
+    VertexFormat GetVertexFormat() const { return format; }
+    // Dequantization for the vertex shaders: position = offset + attribute * scale.
+    // (0, 1) for VERTEX_FLOAT, so the same shader handles both layouts
+    glm::vec3 GetPositionOffset() const { return positionOffset; }
+    glm::vec3 GetPositionScale() const { return positionScale; }
+    // Bytes in the vertex and index buffers, and what VERTEX_FLOAT would take for the same mesh
+    size_t GetGpuBytes() const;
+    size_t GetFloatLayoutBytes() const { return vertexCount * sizeof(Vertex) + (indexCount + lodIndexCount) * sizeof(uint32_t); }
+
+    // CPU copy of the geometry, empty unless it was kept (see ReleaseCpuGeometry)
+    bool HasCpuGeometry() const {
+        return vertices.size() == vertexCount && indices.size() == indexCount && lodIndices.size() == lodIndexCount;
+    }
+    const std::vector<Vertex>& GetVertices() const { return vertices; }
+    const std::vector<uint32_t>& GetIndices() const { return indices; }
+    void ReleaseCpuGeometry();
+
+    // Copy the geometry out (e.g. for packing into a GeometryArena): from the CPU copy
+    // if it was kept, otherwise read back from the GL buffers (compressed meshes are
+    // decoded, so positions carry the quantization error)
+    void ReadGeometry(std::vector<Vertex>& outVertices, std::vector<uint32_t>& outIndices) const;
+    // Indices of the coarser levels (ranges in GetLods), from the CPU copy or the GL buffer
+    void ReadLodIndices(std::vector<uint32_t>& outIndices) const;
 
-    glm::mat4 transformation;
     size_t materialIndex;
     size_t triangleCount; // Number of triangles (indices.size() / 3)
     glm::vec3 center; // Bounding box center (for distance calculations)
     glm::vec3 bboxMin; // Bounding box minimum (local space)
     glm::vec3 bboxMax; // Bounding box maximum (local space)
-    bool useForward = false; // Whether to use forward rendering for this mesh
 
 private:
+    void Upload(const Vertex* vertexData, const uint32_t* indexData, const uint32_t* lodIndexData);
+    void UploadCompressed(const Vertex* vertexData, const uint32_t* indexData, const uint32_t* lodIndexData);
+    // Element buffer: level 0 followed by the coarser levels
+    void UploadIndices(const uint32_t* indexData, const uint32_t* lodIndexData, bool shortIndices);
+    void ReadIndices(size_t first, size_t count, uint32_t* out) const; // From the element buffer
+    void DeleteBuffers();
+
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
+    std::vector<uint32_t> lodIndices;
+    std::vector<MeshLod> lods;
+    size_t vertexCount, indexCount, lodIndexCount;
+
+    VertexFormat format;
+    uint32_t indexType; // GL_UNSIGNED_INT or GL_UNSIGNED_SHORT
+    glm::vec3 positionOffset, positionScale;
 
     uint32_t vao, vbo, ebo;
 
-};
\ No newline at end of file
+};
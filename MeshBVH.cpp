@@ -0,0 +1,128 @@
+#include "MeshBVH.h"
+
+#include <algorithm>
+#include <cfloat>
+
+void MeshBVH::Build(const std::vector<glm::vec3>& boundsMin, const std::vector<glm::vec3>& boundsMax){
+    nodes.clear();
+    meshIndices.resize(boundsMin.size());
+    if (boundsMin.empty()) return;
+
+    std::vector<glm::vec3> centroids(boundsMin.size());
+    for (size_t i = 0; i < boundsMin.size(); i++) {
+        meshIndices[i] = (uint32_t)i;
+        centroids[i] = (boundsMin[i] + boundsMax[i]) * 0.5f;
+    }
+
+    nodes.reserve(2 * boundsMin.size() / MAX_LEAF_SIZE + 1);
+    BuildNode(0, (uint32_t)meshIndices.size(), boundsMin, boundsMax, centroids);
+
+    // Mesh bounds in tree order, for the per-mesh test in partially visible leaves
+    sortedMin.resize(meshIndices.size());
+    sortedMax.resize(meshIndices.size());
+    for (size_t i = 0; i < meshIndices.size(); i++) {
+        sortedMin[i] = boundsMin[meshIndices[i]];
+        sortedMax[i] = boundsMax[meshIndices[i]];
+    }
+}
+
+uint32_t MeshBVH::BuildNode(uint32_t first, uint32_t count,
+                            const std::vector<glm::vec3>& boundsMin, const std::vector<glm::vec3>& boundsMax,
+                            const std::vector<glm::vec3>& centroids){
+    uint32_t index = (uint32_t)nodes.size();
+    nodes.push_back(Node{glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX), first, count, 0});
+
+    glm::vec3 nodeMin(FLT_MAX), nodeMax(-FLT_MAX);
+    glm::vec3 centroidMin(FLT_MAX), centroidMax(-FLT_MAX);
+    for (uint32_t i = first; i < first + count; i++) {
+        uint32_t mesh = meshIndices[i];
+        nodeMin = glm::min(nodeMin, boundsMin[mesh]);
+        nodeMax = glm::max(nodeMax, boundsMax[mesh]);
+        centroidMin = glm::min(centroidMin, centroids[mesh]);
+        centroidMax = glm::max(centroidMax, centroids[mesh]);
+    }
+    nodes[index].boundsMin = nodeMin;
+    nodes[index].boundsMax = nodeMax;
+
+    if (count <= MAX_LEAF_SIZE) {
+        return index;
+    }
+
+    // Median split along the longest axis of the centroid bounds
+    glm::vec3 extent = centroidMax - centroidMin;
+    int axis = 0;
+    if (extent.y > extent.x) axis = 1;
+    if (extent.z > extent[axis]) axis = 2;
+
+    uint32_t half = count / 2;
+    std::nth_element(meshIndices.begin() + first, meshIndices.begin() + first + half, meshIndices.begin() + first + count,
+                     [&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+
+    BuildNode(first, half, boundsMin, boundsMax, centroids);
+    uint32_t right = BuildNode(first + half, count - half, boundsMin, boundsMax, centroids);
+    nodes[index].right = right;
+    return index;
+}
+
+void MeshBVH::Cull(const Frustum& frustum, std::vector<uint32_t>& visibleMeshes) const{
+    visibleMeshes.clear();
+    if (nodes.empty()) return;
+
+    uint32_t stack[64];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0) {
+        const Node& node = nodes[stack[--stackSize]];
+
+        Frustum::Result result = frustum.TestAABB(node.boundsMin, node.boundsMax);
+        if (result == Frustum::OUTSIDE) continue;
+
+        if (node.right == 0) {
+            // Leaf: test each mesh unless the whole leaf is inside
+            for (uint32_t i = node.first; i < node.first + node.count; i++) {
+                if (result == Frustum::INSIDE || frustum.TestAABB(sortedMin[i], sortedMax[i]) != Frustum::OUTSIDE) {
+                    visibleMeshes.push_back(meshIndices[i]);
+                }
+            }
+        } else if (result == Frustum::INSIDE) {
+            visibleMeshes.insert(visibleMeshes.end(), meshIndices.begin() + node.first,
+                                 meshIndices.begin() + node.first + node.count);
+        } else {
+            uint32_t left = (uint32_t)(&node - nodes.data()) + 1;
+            stack[stackSize++] = node.right;
+            stack[stackSize++] = left;
+        }
+    }
+
+    // Keep the scene's submission order
+    std::sort(visibleMeshes.begin(), visibleMeshes.end());
+}
+
+void MeshBVH::QuerySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& touchedMeshes) const{
+    touchedMeshes.clear();
+    if (nodes.empty()) return;
+
+    auto touches = [&](const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+        glm::vec3 offset = center - glm::clamp(center, boundsMin, boundsMax);
+        return glm::dot(offset, offset) <= radius * radius;
+    };
+
+    uint32_t stack[64];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0) {
+        const Node& node = nodes[stack[--stackSize]];
+        if (!touches(node.boundsMin, node.boundsMax)) continue;
+
+        if (node.right == 0) {
+            for (uint32_t i = node.first; i < node.first + node.count; i++) {
+                if (touches(sortedMin[i], sortedMax[i])) touchedMeshes.push_back(meshIndices[i]);
+            }
+        } else {
+            stack[stackSize++] = node.right;
+            stack[stackSize++] = (uint32_t)(&node - nodes.data()) + 1;
+        }
+    }
+}
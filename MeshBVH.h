@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Frustum.h"
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// Bounding volume hierarchy over the world-space AABBs of a static mesh list,
+// built once at scene load (median split on the longest centroid axis).
+// Every node covers a contiguous range of meshIndices, so subtrees that are
+// entirely inside the frustum are emitted without testing their children.
+class MeshBVH{
+public:
+    static const int MAX_LEAF_SIZE = 4;
+
+    // boundsMin[i]/boundsMax[i] is the world-space AABB of mesh i
+    void Build(const std::vector<glm::vec3>& boundsMin, const std::vector<glm::vec3>& boundsMax);
+
+    // Replace visibleMeshes with the indices of meshes whose bounds touch the frustum, ascending
+    void Cull(const Frustum& frustum, std::vector<uint32_t>& visibleMeshes) const;
+
+    // Replace touchedMeshes with the indices of meshes whose bounds touch the sphere (unordered)
+    void QuerySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& touchedMeshes) const;
+
+    size_t GetNodeCount() const { return nodes.size(); }
+
+private:
+    struct Node {
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        uint32_t first;  // Range in meshIndices covered by this subtree
+        uint32_t count;
+        uint32_t right;  // Second child (first child is the next node); 0 for leaves
+    };
+
+    uint32_t BuildNode(uint32_t first, uint32_t count,
+                       const std::vector<glm::vec3>& boundsMin, const std::vector<glm::vec3>& boundsMax,
+                       const std::vector<glm::vec3>& centroids);
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> meshIndices;
+    std::vector<glm::vec3> sortedMin; // Mesh bounds in meshIndices order
+    std::vector<glm::vec3> sortedMax;
+};
@@ -0,0 +1,290 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+
+// Byte-wise hash and equality, so only exact duplicates are welded
+struct VertexHash {
+    size_t operator()(const Vertex& vertex) const {
+        const uint8_t* bytes = (const uint8_t*)&vertex;
+        uint64_t hash = 14695981039346656037ull; // 64-bit FNV-1a
+        for (size_t i = 0; i < sizeof(Vertex); i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return (size_t)hash;
+    }
+};
+
+struct VertexEqual {
+    bool operator()(const Vertex& a, const Vertex& b) const {
+        return std::memcmp(&a, &b, sizeof(Vertex)) == 0;
+    }
+};
+
+// FIFO post-transform cache that can be flushed in O(1)
+class CacheSimulator{
+public:
+    CacheSimulator(size_t vertexCount, int cacheSize) : entered(vertexCount, 0), clock(0), cacheSize(cacheSize) {}
+    // Returns the misses of one triangle
+    int Triangle(const uint32_t* triangle) {
+        int misses = 0;
+        for (int k = 0; k < 3; k++) {
+            size_t& time = entered[triangle[k]];
+            if (time == 0 || clock - time >= (size_t)cacheSize) {
+                time = ++clock;
+                misses++;
+            }
+        }
+        return misses;
+    }
+    void Flush() { clock += cacheSize; }
+
+private:
+    std::vector<size_t> entered; // clock value when each vertex entered the cache
+    size_t clock;                // Number of misses so far (plus flushes)
+    int cacheSize;
+};
+
+void SplitClusters(const std::vector<uint32_t>& indices, size_t vertexCount,
+                   const std::vector<uint32_t>& hardStarts, std::vector<uint32_t>& softStarts){
+    size_t triangleCount = indices.size() / 3;
+    CacheSimulator cache(vertexCount, VERTEX_CACHE_SIZE);
+    softStarts.clear();
+
+    for (size_t h = 0; h < hardStarts.size(); h++) {
+        size_t start = hardStarts[h];
+        size_t end = h + 1 < hardStarts.size() ? hardStarts[h + 1] : triangleCount;
+
+        cache.Flush();
+        size_t clusterMisses = 0;
+        for (size_t t = start; t < end; t++) clusterMisses += cache.Triangle(&indices[t * 3]);
+        float limit = OVERDRAW_ACMR_THRESHOLD * (float)clusterMisses / (float)(end - start);
+
+        cache.Flush();
+        softStarts.push_back((uint32_t)start);
+        size_t runStart = start, runMisses = 0;
+        for (size_t t = start; t < end; t++) {
+            runMisses += cache.Triangle(&indices[t * 3]);
+            if (t + 1 < end && (float)runMisses <= limit * (float)(t + 1 - runStart)) {
+                softStarts.push_back((uint32_t)(t + 1));
+                runStart = t + 1;
+                runMisses = 0;
+                cache.Flush();
+            }
+        }
+    }
+}
+
+}
+
+void WeldVertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices){
+    std::unordered_map<Vertex, uint32_t, VertexHash, VertexEqual> unique;
+    unique.reserve(vertices.size());
+    std::vector<uint32_t> remap(vertices.size());
+    std::vector<Vertex> welded;
+    welded.reserve(vertices.size());
+
+    for (size_t i = 0; i < vertices.size(); i++) {
+        auto inserted = unique.emplace(vertices[i], (uint32_t)welded.size());
+        if (inserted.second) welded.push_back(vertices[i]);
+        remap[i] = inserted.first->second;
+    }
+    for (uint32_t& index : indices) {
+        index = remap[index];
+    }
+    vertices.swap(welded);
+}
+
+void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize,
+                         std::vector<uint32_t>& clusterStarts){
+    size_t triangleCount = indices.size() / 3;
+    clusterStarts.clear();
+    if (triangleCount == 0) return;
+
+    // Vertex -> triangle adjacency (compressed rows)
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (uint32_t index : indices) adjacencyOffsets[index + 1]++;
+    for (size_t v = 0; v < vertexCount; v++) adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; t++) {
+        for (int k = 0; k < 3; k++) adjacency[fill[indices[t * 3 + k]]++] = (uint32_t)t;
+    }
+
+    std::vector<uint32_t> liveTriangles(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) liveTriangles[v] = adjacencyOffsets[v + 1] - adjacencyOffsets[v];
+    std::vector<int> cacheTime(vertexCount, 0); // When each vertex last entered the cache
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    std::vector<uint32_t> deadEnd;   // Recently used vertices, tried when fanning stalls
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+
+    int time = cacheSize + 1;
+    size_t cursor = 0; // Next vertex to scan once the dead-end stack runs dry
+
+    auto skipDeadEnd = [&]() -> int64_t {
+        while (!deadEnd.empty()) {
+            uint32_t vertex = deadEnd.back();
+            deadEnd.pop_back();
+            if (liveTriangles[vertex] > 0) return vertex;
+        }
+        for (; cursor < vertexCount; cursor++) {
+            if (liveTriangles[cursor] > 0) {
+                clusterStarts.push_back((uint32_t)(output.size() / 3)); // Hard boundary
+                return (int64_t)cursor;
+            }
+        }
+        return -1;
+    };
+
+    int64_t fan = skipDeadEnd();
+    while (fan >= 0) {
+        candidates.clear();
+        for (uint32_t a = adjacencyOffsets[fan]; a < adjacencyOffsets[fan + 1]; a++) {
+            uint32_t t = adjacency[a];
+            if (emitted[t]) continue;
+            emitted[t] = 1;
+            for (int k = 0; k < 3; k++) {
+                uint32_t vertex = indices[t * 3 + k];
+                output.push_back(vertex);
+                deadEnd.push_back(vertex);
+                candidates.push_back(vertex);
+                liveTriangles[vertex]--;
+                if (time - cacheTime[vertex] > cacheSize) cacheTime[vertex] = time++;
+            }
+        }
+
+        // Next fan: the oldest candidate still in cache whose remaining triangles fit
+        int64_t next = -1;
+        int bestPriority = -1;
+        for (uint32_t vertex : candidates) {
+            if (liveTriangles[vertex] == 0) continue;
+            int priority = 0;
+            if (time - cacheTime[vertex] + 2 * (int)liveTriangles[vertex] <= cacheSize) {
+                priority = time - cacheTime[vertex];
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                next = vertex;
+            }
+        }
+        fan = next >= 0 ? next : skipDeadEnd();
+    }
+
+    indices.swap(output);
+}
+
+size_t OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices,
+                        const std::vector<uint32_t>& hardClusterStarts){
+    size_t triangleCount = indices.size() / 3;
+    if (hardClusterStarts.empty()) return 0;
+    std::vector<uint32_t> clusterStarts;
+    SplitClusters(indices, vertices.size(), hardClusterStarts, clusterStarts);
+    if (clusterStarts.size() < 2) return clusterStarts.size();
+
+    struct Cluster {
+        uint32_t first, count;
+        glm::vec3 centroid; // Area-weighted
+        glm::vec3 normal;   // Sum of area-scaled face normals
+        float area;
+        float sortKey;
+    };
+    std::vector<Cluster> clusters(clusterStarts.size());
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+
+    for (size_t c = 0; c < clusters.size(); c++) {
+        Cluster& cluster = clusters[c];
+        cluster.first = clusterStarts[c];
+        cluster.count = (uint32_t)((c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : triangleCount) - cluster.first);
+        cluster.centroid = glm::vec3(0.0f);
+        cluster.normal = glm::vec3(0.0f);
+        cluster.area = 0.0f;
+        for (uint32_t t = cluster.first; t < cluster.first + cluster.count; t++) {
+            const glm::vec3& p0 = vertices[indices[t * 3]].position;
+            const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+            const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+            glm::vec3 faceNormal = glm::cross(p1 - p0, p2 - p0); // Length is twice the area
+            float area = glm::length(faceNormal) * 0.5f;
+            cluster.centroid += (p0 + p1 + p2) * (area / 3.0f);
+            cluster.normal += faceNormal;
+            cluster.area += area;
+        }
+        meshCentroid += cluster.centroid;
+        meshArea += cluster.area;
+        if (cluster.area > 0.0f) cluster.centroid /= cluster.area;
+    }
+    if (meshArea <= 0.0f) return clusters.size();
+    meshCentroid /= meshArea;
+
+    for (Cluster& cluster : clusters) {
+        float normalLength = glm::length(cluster.normal);
+        cluster.sortKey = normalLength > 0.0f
+            ? glm::dot(cluster.centroid - meshCentroid, cluster.normal / normalLength) : 0.0f;
+    }
+    std::stable_sort(clusters.begin(), clusters.end(),
+                     [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    for (const Cluster& cluster : clusters) {
+        output.insert(output.end(), indices.begin() + cluster.first * 3,
+                      indices.begin() + (cluster.first + cluster.count) * 3);
+    }
+    indices.swap(output);
+    return clusters.size();
+}
+
+void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices){
+    const uint32_t UNUSED = UINT32_MAX;
+    std::vector<uint32_t> remap(vertices.size(), UNUSED);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+
+    for (uint32_t& index : indices) {
+        if (remap[index] == UNUSED) {
+            remap[index] = (uint32_t)reordered.size();
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(reordered);
+}
+
+float ComputeACMR(const std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize){
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) return 0.0f;
+
+    CacheSimulator cache(vertexCount, cacheSize);
+    size_t misses = 0;
+    for (size_t t = 0; t < triangleCount; t++) misses += cache.Triangle(&indices[t * 3]);
+    return (float)misses / (float)triangleCount;
+}
+
+MeshOptimizationStats OptimizeMesh(MeshData& data){
+    MeshOptimizationStats stats;
+    stats.verticesBefore = stats.verticesAfter = data.vertices.size();
+    stats.triangles = data.indices.size() / 3;
+    stats.acmrBefore = stats.acmrAfter = ComputeACMR(data.indices, data.vertices.size(), VERTEX_CACHE_SIZE);
+
+    // Leave anything that is not a clean triangle list alone
+    if (data.indices.size() % 3 != 0 || data.indices.empty()) return stats;
+    for (uint32_t index : data.indices) {
+        if (index >= data.vertices.size()) return stats;
+    }
+
+    WeldVertices(data.vertices, data.indices);
+    std::vector<uint32_t> clusterStarts;
+    OptimizeVertexCache(data.indices, data.vertices.size(), VERTEX_CACHE_SIZE, clusterStarts);
+    stats.clusters = OptimizeOverdraw(data.indices, data.vertices, clusterStarts);
+    OptimizeVertexFetch(data.vertices, data.indices);
+
+    stats.verticesAfter = data.vertices.size();
+    stats.acmrAfter = ComputeACMR(data.indices, data.vertices.size(), VERTEX_CACHE_SIZE);
+    return stats;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Mesh.h"
+
+#include <vector>
+#include <cstdint>
+
+// Import-time index/vertex optimization of one mesh (thread-safe, no GL calls).
+// Run on the import workers, so the scene cache stores the optimized geometry.
+
+// Post-transform vertex cache size assumed by the reordering and by ACMR
+const int VERTEX_CACHE_SIZE = 16;
+// How much worse than its cluster's ACMR a split point may be (OptimizeOverdraw)
+const float OVERDRAW_ACMR_THRESHOLD = 1.05f;
+
+struct MeshOptimizationStats {
+    size_t verticesBefore = 0;
+    size_t verticesAfter = 0;  // After welding and dropping unreferenced vertices
+    size_t triangles = 0;
+    float acmrBefore = 0.0f;   // Average cache miss ratio: transformed vertices per triangle
+    float acmrAfter = 0.0f;    // (0.5 is ideal for large regular meshes, 3.0 is no reuse)
+    size_t clusters = 0;       // Triangle clusters ordered for overdraw
+};
+
+// Weld, then reorder triangles for the vertex cache and for overdraw, then reorder
+// vertices for fetch locality. Keeps bboxMin/bboxMax (positions are not changed).
+MeshOptimizationStats OptimizeMesh(MeshData& data);
+
+// Merge bit-identical vertices and rewrite the indices to the survivors
+void WeldVertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+// Tipsify (Sander, Nehab, Barczak 2007): fan around recently used vertices while their
+// remaining triangles still fit in a cacheSize cache. clusterStarts receives the first
+// triangle of every run that began after a dead end (cache effectively flushed).
+void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize,
+                         std::vector<uint32_t>& clusterStarts);
+
+// Split the cache-ordered clusters further wherever the run so far is within
+// OVERDRAW_ACMR_THRESHOLD of its cluster's ACMR, then sort them so outward-facing
+// ones, which tend to occlude the rest of the mesh, come first. Clusters stay
+// contiguous, so the cache order inside each survives. Returns the cluster count
+size_t OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices,
+                        const std::vector<uint32_t>& clusterStarts);
+
+// Renumber vertices in order of first use and drop unreferenced ones
+void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+// Vertex shader invocations per triangle for a FIFO post-transform cache of cacheSize
+float ComputeACMR(const std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize);
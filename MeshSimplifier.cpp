@@ -0,0 +1,271 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+
+// Extra weight of the planes that pin open borders in place
+const double BOUNDARY_WEIGHT = 10.0;
+// Minimum cosine between a triangle's normal before and after a collapse
+const float MIN_NORMAL_COSINE = 0.2f;
+
+// Symmetric 4x4 error quadric of weighted planes n.p + d = 0
+struct Quadric {
+    double xx = 0, xy = 0, xz = 0, yy = 0, yz = 0, zz = 0;
+    double dx = 0, dy = 0, dz = 0, dd = 0;
+    double weight = 0;
+
+    void AddPlane(const glm::vec3& n, float d, double w) {
+        xx += w * n.x * n.x; xy += w * n.x * n.y; xz += w * n.x * n.z;
+        yy += w * n.y * n.y; yz += w * n.y * n.z; zz += w * n.z * n.z;
+        dx += w * n.x * d;   dy += w * n.y * d;   dz += w * n.z * d;
+        dd += w * d * d;
+        weight += w;
+    }
+    void Add(const Quadric& q) {
+        xx += q.xx; xy += q.xy; xz += q.xz; yy += q.yy; yz += q.yz; zz += q.zz;
+        dx += q.dx; dy += q.dy; dz += q.dz; dd += q.dd;
+        weight += q.weight;
+    }
+    // Weighted sum of squared plane distances at p
+    double Evaluate(const glm::vec3& p) const {
+        double x = p.x, y = p.y, z = p.z;
+        return xx * x * x + yy * y * y + zz * z * z + 2.0 * (xy * x * y + xz * x * z + yz * y * z)
+             + 2.0 * (dx * x + dy * y + dz * z) + dd;
+    }
+};
+
+// Mean squared distance to the planes of a and b when a moves onto b
+double CollapseCost(const Quadric& a, const Quadric& b, const glm::vec3& target) {
+    Quadric q = a;
+    q.Add(b);
+    return q.weight > 0.0 ? std::max(q.Evaluate(target), 0.0) / q.weight : 0.0;
+}
+
+struct PositionHash {
+    size_t operator()(const glm::vec3& p) const {
+        const uint8_t* bytes = (const uint8_t*)&p;
+        uint64_t hash = 14695981039346656037ull; // 64-bit FNV-1a
+        for (size_t i = 0; i < sizeof(glm::vec3); i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return (size_t)hash;
+    }
+};
+
+struct PositionEqual {
+    bool operator()(const glm::vec3& a, const glm::vec3& b) const {
+        return std::memcmp(&a, &b, sizeof(glm::vec3)) == 0;
+    }
+};
+
+struct Collapse {
+    uint32_t from, to;
+    double cost;
+};
+
+uint64_t EdgeKey(uint32_t a, uint32_t b) {
+    return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+}
+
+}
+
+std::vector<uint32_t> SimplifyMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                                   size_t targetIndexCount, float maxError, float& outError){
+    outError = 0.0f;
+
+    // Collapse in position space, so seam vertices (same position, different normal) stay together
+    std::unordered_map<glm::vec3, uint32_t, PositionHash, PositionEqual> positionIds;
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> positionOf(vertices.size());
+    for (size_t v = 0; v < vertices.size(); v++) {
+        auto inserted = positionIds.emplace(vertices[v].position, (uint32_t)positions.size());
+        if (inserted.second) positions.push_back(vertices[v].position);
+        positionOf[v] = inserted.first->second;
+    }
+    size_t positionCount = positions.size();
+
+    // Triangles as positions, with the original vertex of every corner alongside
+    std::vector<uint32_t> triangles, corners;
+    triangles.reserve(indices.size());
+    corners.reserve(indices.size());
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        uint32_t p0 = positionOf[indices[i]], p1 = positionOf[indices[i + 1]], p2 = positionOf[indices[i + 2]];
+        if (p0 == p1 || p1 == p2 || p0 == p2) continue;
+        triangles.insert(triangles.end(), {p0, p1, p2});
+        corners.insert(corners.end(), {indices[i], indices[i + 1], indices[i + 2]});
+    }
+
+    // Area-weighted face planes, plus perpendicular planes along edges used by one triangle
+    std::vector<Quadric> quadrics(positionCount);
+    std::unordered_map<uint64_t, int64_t> edgeOwner; // Triangle of a border edge, -1 once shared
+    for (size_t t = 0; t < triangles.size() / 3; t++) {
+        const glm::vec3& a = positions[triangles[t * 3]];
+        glm::vec3 normal = glm::cross(positions[triangles[t * 3 + 1]] - a, positions[triangles[t * 3 + 2]] - a);
+        float doubleArea = glm::length(normal);
+        if (doubleArea <= 0.0f) continue;
+        normal /= doubleArea;
+        for (int k = 0; k < 3; k++) quadrics[triangles[t * 3 + k]].AddPlane(normal, -glm::dot(normal, a), doubleArea * 0.5);
+        for (int k = 0; k < 3; k++) {
+            auto inserted = edgeOwner.emplace(EdgeKey(triangles[t * 3 + k], triangles[t * 3 + (k + 1) % 3]), (int64_t)t);
+            if (!inserted.second) inserted.first->second = -1;
+        }
+    }
+    for (const auto& edge : edgeOwner) {
+        if (edge.second < 0) continue;
+        uint32_t p0 = (uint32_t)(edge.first >> 32), p1 = (uint32_t)edge.first;
+        size_t t = (size_t)edge.second;
+        const glm::vec3& a = positions[triangles[t * 3]];
+        glm::vec3 faceNormal = glm::cross(positions[triangles[t * 3 + 1]] - a, positions[triangles[t * 3 + 2]] - a);
+        glm::vec3 edgeVector = positions[p1] - positions[p0];
+        glm::vec3 normal = glm::cross(edgeVector, faceNormal);
+        float length = glm::length(normal);
+        if (length <= 0.0f) continue;
+        normal /= length;
+        double weight = BOUNDARY_WEIGHT * glm::dot(edgeVector, edgeVector);
+        float d = -glm::dot(normal, positions[p0]);
+        quadrics[p0].AddPlane(normal, d, weight);
+        quadrics[p1].AddPlane(normal, d, weight);
+    }
+
+    std::vector<uint32_t> collapsedTo(positionCount);
+    for (size_t p = 0; p < positionCount; p++) collapsedTo[p] = (uint32_t)p;
+    double costLimit = (double)maxError * maxError;
+
+    // Passes of independent collapses, cheapest first; adjacency is rebuilt between passes
+    std::vector<uint32_t> adjacencyOffsets, adjacency;
+    std::vector<Collapse> candidates;
+    std::vector<uint8_t> locked(positionCount);
+    while (triangles.size() > targetIndexCount) {
+        adjacencyOffsets.assign(positionCount + 1, 0);
+        for (uint32_t p : triangles) adjacencyOffsets[p + 1]++;
+        for (size_t p = 0; p < positionCount; p++) adjacencyOffsets[p + 1] += adjacencyOffsets[p];
+        adjacency.resize(triangles.size());
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < triangles.size(); i++) adjacency[fill[triangles[i]]++] = (uint32_t)(i / 3);
+
+        candidates.clear();
+        for (size_t t = 0; t < triangles.size() / 3; t++) {
+            for (int k = 0; k < 3; k++) {
+                // Interior edges appear twice; the duplicate is skipped by the locks below
+                uint32_t a = triangles[t * 3 + k], b = triangles[t * 3 + (k + 1) % 3];
+                double costAB = CollapseCost(quadrics[a], quadrics[b], positions[b]);
+                double costBA = CollapseCost(quadrics[b], quadrics[a], positions[a]);
+                candidates.push_back(costAB <= costBA ? Collapse{a, b, costAB} : Collapse{b, a, costBA});
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(),
+                  [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+        std::fill(locked.begin(), locked.end(), 0);
+        size_t remaining = triangles.size();
+        size_t collapses = 0;
+        for (const Collapse& collapse : candidates) {
+            if (collapse.cost > costLimit || remaining <= targetIndexCount) break;
+            if (locked[collapse.from] || locked[collapse.to]) continue;
+
+            // Triangles on the edge disappear; the others must not flip or fold
+            size_t removed = 0;
+            bool valid = true;
+            for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1] && valid; a++) {
+                const uint32_t* triangle = &triangles[adjacency[a] * 3];
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) {
+                    removed++;
+                    continue;
+                }
+                glm::vec3 before[3], after[3];
+                for (int k = 0; k < 3; k++) {
+                    before[k] = positions[triangle[k]];
+                    after[k] = triangle[k] == collapse.from ? positions[collapse.to] : before[k];
+                }
+                glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+                glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+                float lengths = glm::length(normalBefore) * glm::length(normalAfter);
+                valid = lengths > 0.0f && glm::dot(normalBefore, normalAfter) >= MIN_NORMAL_COSINE * lengths;
+            }
+            if (!valid) continue;
+
+            collapsedTo[collapse.from] = collapse.to;
+            quadrics[collapse.to].Add(quadrics[collapse.from]);
+            for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1]; a++) {
+                for (int k = 0; k < 3; k++) locked[triangles[adjacency[a] * 3 + k]] = 1;
+            }
+            locked[collapse.to] = 1;
+            remaining -= removed * 3;
+            collapses++;
+            outError = std::max(outError, (float)std::sqrt(collapse.cost));
+        }
+        if (collapses == 0) break;
+
+        // Apply this pass's collapses and drop the triangles that became degenerate
+        size_t write = 0;
+        for (size_t t = 0; t < triangles.size() / 3; t++) {
+            uint32_t p[3];
+            for (int k = 0; k < 3; k++) p[k] = collapsedTo[triangles[t * 3 + k]];
+            if (p[0] == p[1] || p[1] == p[2] || p[0] == p[2]) continue;
+            for (int k = 0; k < 3; k++) {
+                triangles[write + k] = p[k];
+                corners[write + k] = corners[t * 3 + k];
+            }
+            write += 3;
+        }
+        triangles.resize(write);
+        corners.resize(write);
+    }
+
+    // Back to vertex indices: a corner whose position moved takes the vertex at the
+    // new position whose normal is closest to its own
+    std::vector<uint32_t> firstVertexAt(positionCount + 1, 0), verticesAt(vertices.size());
+    for (uint32_t p : positionOf) firstVertexAt[p + 1]++;
+    for (size_t p = 0; p < positionCount; p++) firstVertexAt[p + 1] += firstVertexAt[p];
+    std::vector<uint32_t> fill(firstVertexAt.begin(), firstVertexAt.end() - 1);
+    for (size_t v = 0; v < vertices.size(); v++) verticesAt[fill[positionOf[v]]++] = (uint32_t)v;
+
+    std::vector<uint32_t> result(triangles.size());
+    for (size_t i = 0; i < triangles.size(); i++) {
+        uint32_t original = corners[i];
+        uint32_t position = triangles[i];
+        if (positionOf[original] == position) {
+            result[i] = original;
+            continue;
+        }
+        uint32_t best = verticesAt[firstVertexAt[position]];
+        float bestCosine = -2.0f;
+        for (uint32_t a = firstVertexAt[position]; a < firstVertexAt[position + 1]; a++) {
+            float cosine = glm::dot(vertices[verticesAt[a]].normal, vertices[original].normal);
+            if (cosine > bestCosine) {
+                bestCosine = cosine;
+                best = verticesAt[a];
+            }
+        }
+        result[i] = best;
+    }
+    return result;
+}
+
+void GenerateLods(MeshData& data){
+    data.lodIndices.clear();
+    data.lods.clear();
+    float maxError = LOD_MAX_RELATIVE_ERROR * glm::length(data.bboxMax - data.bboxMin);
+
+    std::vector<uint32_t> previous = data.indices;
+    std::vector<uint32_t> level, clusterStarts;
+    float error = 0.0f;
+    for (int lod = 0; lod < MAX_GENERATED_LODS; lod++) {
+        size_t target = previous.size() / 6 * 3; // Half the triangles
+        float levelError = 0.0f;
+        level = SimplifyMesh(data.vertices, previous, target, maxError - error, levelError);
+        if (level.empty() || level.size() * 5 > previous.size() * 4) break; // Under 20% fewer
+        error += levelError; // Each level is simplified from the one before, so errors add up
+
+        OptimizeVertexCache(level, data.vertices.size(), VERTEX_CACHE_SIZE, clusterStarts);
+        data.lods.push_back({(uint32_t)data.lodIndices.size(), (uint32_t)level.size(), error});
+        data.lodIndices.insert(data.lodIndices.end(), level.begin(), level.end());
+        previous.swap(level);
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Mesh.h"
+
+#include <vector>
+#include <cstdint>
+
+// Import-time level-of-detail generation (thread-safe, no GL calls)
+
+// Coarser levels generated per mesh, each aiming at half the triangles of the one before
+const int MAX_GENERATED_LODS = 3;
+// Simplification stops once the accumulated error of a level would exceed this fraction
+// of the mesh's bounding-box diagonal
+const float LOD_MAX_RELATIVE_ERROR = 0.05f;
+
+// Quadric error simplification (Garland & Heckbert 1997) by collapsing one vertex
+// position onto a neighbouring one, so the result still indexes the input vertices.
+// Vertices that share a position (normal seams) move together, open borders are
+// held by extra boundary planes, and collapses that would flip a triangle are
+// skipped. Stops at targetIndexCount indices or when the cheapest collapse would
+// exceed maxError; outError receives the largest error accepted (local units).
+std::vector<uint32_t> SimplifyMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                                   size_t targetIndexCount, float maxError, float& outError);
+
+// Fill data.lodIndices/data.lods with up to MAX_GENERATED_LODS coarser index lists,
+// each ordered for the vertex cache. Stops early when a level no longer removes
+// at least a fifth of the triangles.
+void GenerateLods(MeshData& data);
@@ -0,0 +1,152 @@
+#include "OcclusionCulling.h"
+#include "Scene.h"
+#include "Renderer.h"
+
+#include <algorithm>
+
+OcclusionCulling::OcclusionCulling()
+    : boxShader(ReadTextFile("occlusion_box_vert.glsl"), ReadTextFile("occlusion_box_frag.glsl")),
+      boxVAO(), boxVBO(), boxEBO(), frameIndex(0), queriesIssued(0)
+{
+    // Unit cube, corners in [0, 1]
+    float vertices[] = {
+        0.0f, 0.0f, 0.0f,  1.0f, 0.0f, 0.0f,  1.0f, 1.0f, 0.0f,  0.0f, 1.0f, 0.0f,
+        0.0f, 0.0f, 1.0f,  1.0f, 0.0f, 1.0f,  1.0f, 1.0f, 1.0f,  0.0f, 1.0f, 1.0f
+    };
+    unsigned int indices[] = {
+        0, 2, 1,  0, 3, 2, // -z
+        4, 5, 6,  4, 6, 7, // +z
+        0, 1, 5,  0, 5, 4, // -y
+        3, 6, 2,  3, 7, 6, // +y
+        0, 4, 7,  0, 7, 3, // -x
+        1, 2, 6,  1, 6, 5  // +x
+    };
+
+    glGenVertexArrays(1, &boxVAO);
+    glGenBuffers(1, &boxVBO);
+    glGenBuffers(1, &boxEBO);
+
+    glBindVertexArray(boxVAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, boxVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, boxEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+OcclusionCulling::~OcclusionCulling(){
+    if (!queries.empty()) {
+        glDeleteQueries((GLsizei)queries.size(), queries.data());
+    }
+    glDeleteVertexArrays(1, &boxVAO);
+    glDeleteBuffers(1, &boxVBO);
+    glDeleteBuffers(1, &boxEBO);
+}
+
+void OcclusionCulling::Resize(size_t instanceCount){
+    if (queries.size() == instanceCount) return;
+
+    if (!queries.empty()) {
+        glDeleteQueries((GLsizei)queries.size(), queries.data());
+    }
+    queries.assign(instanceCount, 0);
+    if (instanceCount > 0) {
+        glGenQueries((GLsizei)instanceCount, queries.data());
+    }
+    pending.assign(instanceCount, 0);
+    occluded.assign(instanceCount, 0);
+    queryFrame.assign(instanceCount, 0);
+}
+
+void OcclusionCulling::Reset(){
+    // Queries still in flight tested the old classification's depth; never read them back
+    std::fill(pending.begin(), pending.end(), 0);
+    std::fill(occluded.begin(), occluded.end(), 0);
+}
+
+bool OcclusionCulling::ContainsCamera(const Scene& scene, uint32_t instance, const glm::vec3& viewPos) const{
+    // The box's near faces would be clipped by the near plane, so treat it as visible
+    glm::vec3 margin(2.0f * Camera::NearPlane);
+    glm::vec3 boxMin = scene.GetInstanceBoundsMin(instance) - margin;
+    glm::vec3 boxMax = scene.GetInstanceBoundsMax(instance) + margin;
+    return viewPos.x >= boxMin.x && viewPos.y >= boxMin.y && viewPos.z >= boxMin.z &&
+           viewPos.x <= boxMax.x && viewPos.y <= boxMax.y && viewPos.z <= boxMax.z;
+}
+
+void OcclusionCulling::Filter(const Scene& scene, const glm::vec3& viewPos,
+                              const std::vector<uint32_t>& candidates, std::vector<uint32_t>& visibleInstances){
+    Resize(scene.GetInstanceCount());
+    frameIndex++;
+
+    visibleInstances.clear();
+    for (uint32_t instance : candidates) {
+        if (pending[instance]) {
+            GLuint available = 0;
+            glGetQueryObjectuiv(queries[instance], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available) {
+                GLuint anySamples = 0;
+                glGetQueryObjectuiv(queries[instance], GL_QUERY_RESULT, &anySamples);
+                occluded[instance] = anySamples == 0;
+                pending[instance] = 0;
+            }
+        }
+
+        // Only trust a finished result from the previous frame's depth
+        bool hidden = !pending[instance] && occluded[instance] && queryFrame[instance] + 1 == frameIndex
+                      && !ContainsCamera(scene, instance, viewPos);
+        if (!hidden) {
+            visibleInstances.push_back(instance);
+        }
+    }
+}
+
+void OcclusionCulling::IssueQueries(const Scene& scene, const glm::vec3& viewPos, const std::vector<uint32_t>& candidates,
+                                    const glm::mat4& view, const glm::mat4& projection){
+    queriesIssued = 0;
+
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    glDepthFunc(GL_LEQUAL);
+
+    boxShader.Use();
+    boxShader.SetValue("view", view);
+    boxShader.SetValue("projection", projection);
+    Shader::Uniform<glm::vec3> boxMinUniform = boxShader.GetUniform<glm::vec3>("boxMin");
+    Shader::Uniform<glm::vec3> boxSizeUniform = boxShader.GetUniform<glm::vec3>("boxSize");
+
+    glBindVertexArray(boxVAO);
+    for (uint32_t instance : candidates) {
+        // A query still in flight cannot be reissued without losing its result
+        if (pending[instance] || ContainsCamera(scene, instance, viewPos)) continue;
+
+        // Grow the box slightly so flat instances are not hidden by their own depth
+        glm::vec3 boxMin = scene.GetInstanceBoundsMin(instance);
+        glm::vec3 boxMax = scene.GetInstanceBoundsMax(instance);
+        glm::vec3 margin = (boxMax - boxMin) * 0.01f + glm::vec3(0.001f);
+        boxMin -= margin;
+        boxMax += margin;
+
+        boxShader.Set(boxMinUniform, boxMin);
+        boxShader.Set(boxSizeUniform, boxMax - boxMin);
+
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, queries[instance]);
+        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, nullptr);
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+
+        pending[instance] = 1;
+        queryFrame[instance] = frameIndex;
+        queriesIssued++;
+    }
+    glBindVertexArray(0);
+
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
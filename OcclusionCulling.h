@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Shader.h"
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <GL/glew.h>
+
+class Scene;
+
+// Temporal occlusion culling with GL_ANY_SAMPLES_PASSED queries.
+// After the G-buffer pass, the world-space bounding box of every frustum-visible
+// mesh instance is rasterized (depth test only, no writes) against that frame's depth.
+// The next frame reads back whichever results have arrived without waiting and
+// skips instances whose box produced no samples, in both the G-buffer and forward
+// passes. Instances whose query is still in flight, was issued more than one frame
+// ago, or whose box contains the camera are always drawn. Newly disoccluded meshes
+// therefore appear one frame late. Only deferred geometry acts as an occluder.
+class OcclusionCulling{
+public:
+    OcclusionCulling();
+    ~OcclusionCulling();
+    OcclusionCulling(const OcclusionCulling&) = delete;
+    OcclusionCulling& operator=(const OcclusionCulling&) = delete;
+
+    // Copy the candidates (frustum-visible instances) that were not occluded last frame into visibleInstances
+    void Filter(const Scene& scene, const glm::vec3& viewPos,
+                const std::vector<uint32_t>& candidates, std::vector<uint32_t>& visibleInstances);
+
+    // Query the candidates' bounding boxes against the depth buffer of the bound framebuffer.
+    // Expects depth testing to be enabled; restores color/depth write masks.
+    void IssueQueries(const Scene& scene, const glm::vec3& viewPos, const std::vector<uint32_t>& candidates,
+                      const glm::mat4& view, const glm::mat4& projection);
+
+    // Forget all results (e.g. after the mesh classification changed)
+    void Reset();
+
+    size_t GetQueriesIssued() const { return queriesIssued; } // Queries issued by the last IssueQueries
+
+private:
+    void Resize(size_t instanceCount);
+    bool ContainsCamera(const Scene& scene, uint32_t instance, const glm::vec3& viewPos) const;
+
+    Shader boxShader;
+    GLuint boxVAO, boxVBO, boxEBO;
+
+    std::vector<GLuint> queries;      // One query object per instance
+    std::vector<uint8_t> pending;     // Query issued, result not read yet
+    std::vector<uint8_t> occluded;    // Last read result
+    std::vector<uint32_t> queryFrame; // Frame the pending/last query was issued in
+    uint32_t frameIndex;
+    size_t queriesIssued;
+};
@@ -0,0 +1,118 @@
+#include "OverdrawMetrics.h"
+
+#include <algorithm>
+
+OverdrawMetrics::OverdrawMetrics()
+    : fbo(), depthRB(), width(0), height(0), instanceCount(0), pixelScale(1.0f), pending(false)
+{
+    glGenFramebuffers(1, &fbo);
+    glGenRenderbuffers(1, &depthRB);
+
+    // Depth only; the draw/read buffers are framebuffer state, so this is set once
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+OverdrawMetrics::~OverdrawMetrics(){
+    if (!queryTotal.empty()) {
+        glDeleteQueries((GLsizei)queryTotal.size(), queryTotal.data());
+        glDeleteQueries((GLsizei)queryVisible.size(), queryVisible.data());
+    }
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteRenderbuffers(1, &depthRB);
+}
+
+void OverdrawMetrics::Resize(int targetWidth, int targetHeight, size_t queryCount){
+    if (targetWidth != width || targetHeight != height) {
+        width = targetWidth;
+        height = targetHeight;
+        glBindRenderbuffer(GL_RENDERBUFFER, depthRB);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRB);
+    }
+
+    // Queries only grow; a measurement uses the first queryCount of each
+    if (queryTotal.size() < queryCount) {
+        size_t oldSize = queryTotal.size();
+        queryTotal.resize(queryCount);
+        queryVisible.resize(queryCount);
+        glGenQueries((GLsizei)(queryCount - oldSize), queryTotal.data() + oldSize);
+        glGenQueries((GLsizei)(queryCount - oldSize), queryVisible.data() + oldSize);
+    }
+}
+
+void OverdrawMetrics::Issue(const Scene& scene, Shader& depthShader, int viewportWidth, int viewportHeight,
+                            const glm::mat4& view, const glm::mat4& projection){
+    // Only instances inside the measuring camera's frustum can contribute fragments
+    scene.CullInstances(view, projection, measuredInstances);
+    instanceCount = scene.GetInstanceCount();
+
+    float scale = std::min(std::max(resolutionScale, 0.0f), 1.0f);
+    int targetWidth = std::max(1, (int)(viewportWidth * scale));
+    int targetHeight = std::max(1, (int)(viewportHeight * scale));
+    pixelScale = ((float)viewportWidth * viewportHeight) / ((float)targetWidth * targetHeight);
+    Resize(targetWidth, targetHeight, measuredInstances.size());
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, width, height);
+
+    depthShader.Use();
+    depthShader.SetValue("view", view);
+    depthShader.SetValue("projection", projection);
+    Scene::MeshUniforms uniforms = Scene::MeshUniforms::Resolve(depthShader);
+
+    // Pass 1: fragments shaded with overdraw
+    glClear(GL_DEPTH_BUFFER_BIT);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+    scene.DrawInstancesQueried(depthShader, uniforms, measuredInstances, queryTotal.data());
+
+    // Pass 2: against the finished depth, GL_LEQUAL passes the fragment each pixel ends up with
+    glDepthFunc(GL_LEQUAL);
+    glDepthMask(GL_FALSE);
+    scene.DrawInstancesQueried(depthShader, uniforms, measuredInstances, queryVisible.data());
+
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+    pending = true;
+}
+
+bool OverdrawMetrics::Poll(Scene::SceneMetrics& metrics, bool wait){
+    if (!pending) return false;
+
+    // Queries complete in order, so the last one issued stands for all of them
+    if (!wait && !measuredInstances.empty()) {
+        GLuint available = 0;
+        glGetQueryObjectuiv(queryVisible[measuredInstances.size() - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return false;
+    }
+    pending = false;
+
+    uint64_t totalFragments = 0;
+    uint64_t visiblePixels = 0;
+    metrics.instances.assign(instanceCount, Scene::InstanceMetrics());
+    for (size_t v = 0; v < measuredInstances.size(); v++) {
+        GLuint fragments = 0, visible = 0;
+        glGetQueryObjectuiv(queryTotal[v], GL_QUERY_RESULT, &fragments);
+        glGetQueryObjectuiv(queryVisible[v], GL_QUERY_RESULT, &visible);
+        totalFragments += fragments;
+        visiblePixels += visible;
+
+        Scene::InstanceMetrics& instance = metrics.instances[measuredInstances[v]];
+        instance.fragments = (uint32_t)(fragments * pixelScale + 0.5f);
+        instance.visiblePixels = (uint32_t)(visible * pixelScale + 0.5f);
+    }
+
+    if (visiblePixels == 0) {
+        metrics.overdrawRatio = 1.0f;
+        metrics.screenCoverage = 0.0f;
+    } else {
+        metrics.overdrawRatio = (float)totalFragments / (float)visiblePixels;
+        metrics.screenCoverage = (float)visiblePixels / ((float)width * height);
+    }
+    return true;
+}
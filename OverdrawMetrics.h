@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Scene.h"
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <GL/glew.h>
+
+// Overdraw and coverage measurement for the hybrid classification (Scene::ShouldUseForward).
+// The frustum-visible instances are drawn twice into a depth-only target of resolutionScale
+// times the viewport: first with depth writes, wrapping each instance in a samples-passed
+// query for the fragments it shades, then with GL_LEQUAL and no writes for the pixels it
+// still covers. The target and the query objects persist between measurements, and the
+// results are read back without waiting once GL_QUERY_RESULT_AVAILABLE is set (Poll), so the
+// metrics can be refreshed while rendering. Counts are scaled back to viewport pixels.
+class OverdrawMetrics{
+public:
+    OverdrawMetrics();
+    ~OverdrawMetrics();
+    OverdrawMetrics(const OverdrawMetrics&) = delete;
+    OverdrawMetrics& operator=(const OverdrawMetrics&) = delete;
+
+    // Issue both passes from the given camera. Replaces a measurement still in flight.
+    // Leaves the target bound and the depth state at GL_LESS with writes on; callers bind
+    // their own framebuffer and viewport next
+    void Issue(const Scene& scene, Shader& depthShader, int viewportWidth, int viewportHeight,
+               const glm::mat4& view, const glm::mat4& projection);
+
+    // Copy the last Issue's results into metrics (lights left at zero) once they are all
+    // available; with wait, block until they are. False while none is pending or not done
+    bool Poll(Scene::SceneMetrics& metrics, bool wait = false);
+
+    bool IsPending() const { return pending; }
+
+    float resolutionScale = 0.5f; // Measurement target size relative to the viewport
+
+private:
+    void Resize(int targetWidth, int targetHeight, size_t queryCount);
+
+    GLuint fbo, depthRB;
+    int width, height;                  // Current target size
+    std::vector<GLuint> queryTotal;     // Per visible instance: fragments with overdraw
+    std::vector<GLuint> queryVisible;   // Per visible instance: pixels covered at the end
+    std::vector<uint32_t> measuredInstances; // Instances the queries belong to, in query order
+    size_t instanceCount;
+    float pixelScale;                   // Viewport pixels per target pixel
+    bool pending;
+};
@@ -42,6 +42,12 @@ Quad::Quad() : vao(), vbo(), ebo()
     glBindVertexArray(0);
 }
 
+Quad::~Quad(){
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vbo);
+    glDeleteBuffers(1, &ebo);
+}
+
 void Quad::Draw() const
 {
     glBindVertexArray(vao);
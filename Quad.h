@@ -6,6 +6,9 @@
 class Quad {
 public:
     Quad();
+    ~Quad();
+    Quad(const Quad&) = delete;
+    Quad& operator=(const Quad&) = delete;
     void Draw() const;
 private:
     uint32_t vao, vbo, ebo;
@@ -0,0 +1,87 @@
+#include "RenderQueue.h"
+#include "Scene.h"
+
+#include <cstring>
+#include <algorithm>
+
+uint64_t RenderQueue::MakeKey(Pass pass, uint32_t program, uint32_t material, uint32_t mesh, float viewDepth){
+    // Non-negative IEEE floats order the same as their bit patterns
+    float depth = std::max(viewDepth, 0.0f);
+    uint32_t depthBits;
+    std::memcpy(&depthBits, &depth, sizeof(depthBits));
+
+    uint64_t key = (uint64_t)pass << 62 | (uint64_t)(program & 0x3F) << 56;
+    if (pass == PASS_FORWARD_TRANSPARENT) {
+        key |= (uint64_t)(~depthBits) << 24 | (material & 0xFFFFFF);
+    } else {
+        key |= (uint64_t)(material & 0xFFFF) << 40 | (uint64_t)(mesh & 0xFFFF) << 24 | depthBits >> 8;
+    }
+    return key;
+}
+
+void RenderQueue::Build(const Scene& scene, const std::vector<uint32_t>& visibleInstances, const glm::mat4& view,
+                        uint32_t deferredProgram, uint32_t forwardProgram){
+    items.clear();
+    for (uint32_t index : visibleInstances) {
+        const MeshInstance& instance = scene.GetInstance(index);
+        const Mesh& mesh = scene.GetMesh(instance.mesh);
+        const Material& material = scene.GetMaterial(mesh.materialIndex);
+
+        glm::vec3 center = (scene.GetInstanceBoundsMin(index) + scene.GetInstanceBoundsMax(index)) * 0.5f;
+        float viewDepth = -(view * glm::vec4(center, 1.0f)).z;
+
+        Pass pass = PASS_DEFERRED;
+        if (instance.useForward) {
+            pass = material.opacity < 1.0f ? PASS_FORWARD_TRANSPARENT : PASS_FORWARD_OPAQUE;
+        }
+        uint32_t program = instance.useForward ? forwardProgram : deferredProgram;
+        items.push_back({MakeKey(pass, program, (uint32_t)mesh.materialIndex, instance.mesh, viewDepth), index});
+    }
+
+    RadixSort(items, scratch);
+
+    deferredInstances.clear();
+    forwardInstances.clear();
+    materialChanges = 0;
+    size_t lastMaterial = SIZE_MAX;
+    Pass lastPass = PASS_DEFERRED;
+    for (const Item& item : items) {
+        Pass pass = (Pass)(item.key >> 62);
+        size_t material = scene.GetMesh(scene.GetInstance(item.instance).mesh).materialIndex;
+        // The forward pass starts with no material set
+        if (material != lastMaterial || (pass != PASS_DEFERRED && lastPass == PASS_DEFERRED)) {
+            materialChanges++;
+        }
+        lastMaterial = material;
+        lastPass = pass;
+
+        if (pass == PASS_DEFERRED) {
+            deferredInstances.push_back(item.instance);
+        } else {
+            forwardInstances.push_back(item.instance);
+        }
+    }
+}
+
+void RenderQueue::RadixSort(std::vector<Item>& items, std::vector<Item>& scratch){
+    scratch.resize(items.size());
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t counts[256] = {};
+        for (const Item& item : items) {
+            counts[(item.key >> shift) & 0xFF]++;
+        }
+        // Every key has the same digit: this pass would not move anything
+        if (counts[(items.empty() ? 0 : items[0].key >> shift) & 0xFF] == items.size()) continue;
+
+        size_t offset = 0;
+        for (size_t& count : counts) {
+            size_t c = count;
+            count = offset;
+            offset += c;
+        }
+        for (const Item& item : items) {
+            scratch[counts[(item.key >> shift) & 0xFF]++] = item;
+        }
+        items.swap(scratch);
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+class Scene;
+
+// Per-frame draw ordering. Every visible instance gets a 64-bit sort key:
+//   [63..62] pass            deferred, forward opaque, forward transparent
+//   [61..56] program         low bits of the pass's program id
+//   opaque:      [55..40] material index, [39..24] mesh index,
+//                [23..0] view depth, top 24 bits (front-to-back for early-Z)
+//   transparent: [55..24] inverted view depth (back-to-front), [23..0] material index
+// Keys are LSD radix sorted (stable, so ties keep scene order). Grouping opaque
+// instances by mesh lets the draw functions merge them into instanced draws, and
+// material uniforms are only set when consecutive draws differ in material.
+class RenderQueue{
+public:
+    enum Pass {
+        PASS_DEFERRED = 0,
+        PASS_FORWARD_OPAQUE = 1,
+        PASS_FORWARD_TRANSPARENT = 2
+    };
+
+    struct Item {
+        uint64_t key;
+        uint32_t instance;
+    };
+
+    static uint64_t MakeKey(Pass pass, uint32_t program, uint32_t material, uint32_t mesh, float viewDepth);
+
+    // Key and sort the visible instances; deferredProgram/forwardProgram are the programs of the two passes
+    void Build(const Scene& scene, const std::vector<uint32_t>& visibleInstances, const glm::mat4& view,
+               uint32_t deferredProgram, uint32_t forwardProgram);
+
+    const std::vector<uint32_t>& GetDeferredInstances() const { return deferredInstances; }
+    const std::vector<uint32_t>& GetForwardInstances() const { return forwardInstances; } // Opaque, then transparent
+    size_t GetMaterialChanges() const { return materialChanges; } // Material uniform sets the sorted order needs
+
+    // Stable 8-bit LSD radix sort by key; skips digits that are equal for all keys
+    static void RadixSort(std::vector<Item>& items, std::vector<Item>& scratch);
+
+private:
+    std::vector<Item> items;
+    std::vector<Item> scratch;
+    std::vector<uint32_t> deferredInstances;
+    std::vector<uint32_t> forwardInstances;
+    size_t materialChanges = 0;
+};
@@ -0,0 +1,303 @@
+#include "Renderer.h"
+
+#include <fstream>
+#include <sstream>
+
+Renderer::Renderer(int width, int height, GBufferLayout gbufferLayout)
+    : width(width), height(height), quad(), gbuffer(width, height, gbufferLayout),
+      gbufferShader(ReadTextFile("gbuffer_vert.glsl"), GBuffer::WithLayout(ReadTextFile("gbuffer_frag.glsl"), gbufferLayout)),
+      lightingShader(ReadTextFile("lighting_vert.glsl"), GBuffer::WithLayout(ReadTextFile("lighting_frag.glsl"), gbufferLayout)),
+      forwardShader(ReadTextFile("forward_vertex.glsl"), ReadTextFile("forward_fragment.glsl")),
+      tiledLightingShader(ReadTextFile("lighting_vert.glsl"),
+                          GBuffer::WithLayout(Shader::WithDefines(ReadTextFile("lighting_frag.glsl"), {"TILED_LIGHTING"}),
+                                              gbufferLayout)),
+      tiledLighting(width, height, gbufferLayout),
+      clusteredForwardShader(ReadTextFile("forward_vertex.glsl"),
+                             Shader::WithDefines(ReadTextFile("forward_fragment.glsl"), {"CLUSTERED_LIGHTING"})),
+      clusteredLighting(width, height),
+      lightVolumes(width, height, gbuffer),
+      gbufferMergedShader(Shader::WithDefines(ReadTextFile("gbuffer_vert.glsl"), {"MERGED_GEOMETRY"}),
+                          GBuffer::WithLayout(Shader::WithDefines(ReadTextFile("gbuffer_frag.glsl"), {"MERGED_GEOMETRY"}),
+                                              gbufferLayout)),
+      forwardMergedShader(Shader::WithDefines(ReadTextFile("forward_vertex.glsl"), {"MERGED_GEOMETRY"}),
+                          Shader::WithDefines(ReadTextFile("forward_fragment.glsl"), {"MERGED_GEOMETRY"})),
+      clusteredForwardMergedShader(Shader::WithDefines(ReadTextFile("forward_vertex.glsl"), {"MERGED_GEOMETRY"}),
+                                   Shader::WithDefines(ReadTextFile("forward_fragment.glsl"),
+                                                       {"CLUSTERED_LIGHTING", "MERGED_GEOMETRY"})),
+      forwardQuery()
+{
+    glGenQueries(1, &forwardQuery);
+}
+
+Renderer::~Renderer(){
+    glDeleteQueries(1, &forwardQuery);
+}
+
+void Renderer::Adapt(Scene& scene){
+    profiler.Collect();
+    bool changed = false;
+    for (const GpuProfiler::FrameTimes& times : profiler.TakeCompleted()) {
+        changed |= adaptive.Update(scene, times.frame, times.RenderMs(), frameIndex);
+    }
+
+    // As in Prepare: moved instances change the G-buffer depth occlusion queries test against
+    if (changed) {
+        occlusion.Reset();
+    }
+}
+
+void Renderer::RefreshRenderingMode(Scene& scene, Camera& camera){
+    if (preparedMode != HYBRID || overdrawRefreshFrames <= 0 || adaptiveHybrid) return;
+
+    if (overdraw.IsPending()) {
+        Scene::SceneMetrics metrics;
+        if (!overdraw.Poll(metrics)) return;
+        scene.ApplyHybridMetrics(metrics, width, height, forwardLighting == FORWARD_CLUSTERED);
+
+        // As in Prepare: the classification changed under the occlusion results
+        occlusion.Reset();
+        return;
+    }
+
+    if (frameIndex - overdrawIssueFrame < (size_t)overdrawRefreshFrames) return;
+    glm::mat4 view = camera.GetViewMatrix();
+    glm::mat4 projection = camera.GetProjectionMatrix((float)width, (float)height);
+    profiler.BeginFrame(frameIndex);
+    profiler.Begin(GPU_PASS_OVERDRAW);
+    overdraw.Issue(scene, gbufferShader, width, height, view, projection);
+    profiler.End(GPU_PASS_OVERDRAW);
+    overdrawIssueFrame = frameIndex;
+}
+
+size_t Renderer::GetForwardFragments() const {
+    if (!forwardQueryIssued) return 0;
+    GLuint samples = 0;
+    glGetQueryObjectuiv(forwardQuery, GL_QUERY_RESULT, &samples);
+    return samples;
+}
+
+float Renderer::ExposureForLightCount(size_t numLights){
+    if (numLights == 0) {
+        return 1.0f; // No lights, use standard exposure
+    } else if (numLights <= 5) {
+        return 1.0f; // Few lights: standard exposure
+    } else if (numLights <= 20) {
+        return 0.5f; // Moderate lights: reduce exposure
+    } else if (numLights <= 50) {
+        return 0.3f; // Many lights: lower exposure
+    }
+    return 0.1f; // Very many lights: very low exposure
+}
+
+void Renderer::Prepare(Scene& scene, Mode mode){
+    // Overdraw detection and heuristic evaluation; its GPU time is counted in the next frame
+    profiler.enabled = timePasses || adaptiveHybrid;
+    profiler.BeginFrame(frameIndex);
+    profiler.Begin(GPU_PASS_OVERDRAW);
+    scene.UpdateRenderingMode(overdraw, gbufferShader, width, height, mode, forwardLighting == FORWARD_CLUSTERED);
+    profiler.End(GPU_PASS_OVERDRAW);
+    preparedMode = mode;
+    overdrawIssueFrame = frameIndex;
+
+    float exposure = ExposureForLightCount(scene.GetLightCount());
+
+    for (Shader* shader : {&lightingShader, &tiledLightingShader}) {
+        shader->Use();
+        shader->SetValue("ambientStrength", 0.1f);
+        shader->SetValue("ambientColor", glm::vec3(1.0f));
+        shader->SetValue("exposure", exposure);
+    }
+    for (Shader* shader : {&forwardShader, &clusteredForwardShader, &forwardMergedShader, &clusteredForwardMergedShader}) {
+        shader->Use();
+        shader->SetValue("ambientStrength", 0.1f);
+        shader->SetValue("ambientColor", glm::vec3(1.0f));
+        shader->SetValue("exposure", exposure);
+    }
+    lightVolumes.SetConstants(0.1f, glm::vec3(1.0f), exposure);
+
+    // Mesh classification changed, so last frame's occluders may be gone
+    occlusion.Reset();
+    adaptive.Reset(scene, adaptiveHybrid && mode == HYBRID, frameIndex);
+
+    if (mergedGeometry && !geometryArena.IsBuiltFor(scene)) {
+        geometryArena.Build(scene);
+    }
+}
+
+Renderer::FrameResult Renderer::RenderFrame(const Scene& scene, Camera& camera, GLuint targetFBO){
+    FrameResult result{};
+    Shader::ResetFrameStats();
+
+    profiler.enabled = timePasses || adaptiveHybrid;
+    profiler.BeginFrame(frameIndex);
+
+    glm::mat4 view = camera.GetViewMatrix();
+    glm::mat4 projection = camera.GetProjectionMatrix((float)width, (float)height);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // Frustum culling, then occlusion culling, shared by the G-buffer and forward passes
+    scene.CullInstances(view, projection, frustumInstances);
+    if (occlusionCulling) {
+        occlusion.Filter(scene, camera.position, frustumInstances, visibleInstances);
+    } else {
+        visibleInstances = frustumInstances;
+    }
+    result.visibleMeshes = (int)visibleInstances.size();
+    result.culledMeshes = (int)(scene.GetInstanceCount() - frustumInstances.size());
+    result.occludedMeshes = (int)(frustumInstances.size() - visibleInstances.size());
+
+    bool merged = mergedGeometry && geometryArena.IsBuiltFor(scene);
+    bool clustered = forwardLighting == FORWARD_CLUSTERED && scene.GetForwardInstanceCount() > 0;
+    Shader& forward = merged ? (clustered ? clusteredForwardMergedShader : forwardMergedShader)
+                             : (clustered ? clusteredForwardShader : forwardShader);
+    Shader& gbufferPass = merged ? gbufferMergedShader : gbufferShader;
+
+    // The arena only holds level 0, so LODs apply to the per-mesh path
+    if (levelOfDetail && !merged) {
+        scene.SelectLods(visibleInstances, camera.position, projection, height);
+    } else {
+        scene.ResetLods();
+    }
+
+    // Sort by pass, program, material and depth
+    renderQueue.Build(scene, visibleInstances, view, gbufferPass.programID, forward.programID);
+    result.materialChanges = renderQueue.GetMaterialChanges();
+
+    //-----------------------------------
+    // 1. Deferred G-buffer pass
+    //-----------------------------------
+    profiler.Begin(GPU_PASS_GBUFFER);
+    gbuffer.BindForWriting();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+    gbufferPass.Use();
+    gbufferPass.SetValue("view", view);
+    gbufferPass.SetValue("projection", projection);
+
+    if (lightingPath == LIGHTING_VOLUMES) {
+        lightVolumes.MarkGeometry(); // Stencil = 1 under geometry, so light volumes skip background
+    }
+    if (merged) {
+        result.deferredCount = geometryArena.Draw(gbufferPass, GeometryArena::PASS_DEFERRED, renderQueue.GetDeferredInstances());
+        result.drawCalls += result.deferredCount > 0 ? 1 : 0;
+    } else {
+        result.deferredCount = scene.DrawDeferred(gbufferPass, renderQueue.GetDeferredInstances(), &result.drawCalls,
+                                                  &result.triangles);
+    }
+    glDisable(GL_STENCIL_TEST);
+    profiler.End(GPU_PASS_GBUFFER);
+
+    // Test every frustum-visible instance against this frame's G-buffer depth for the next frame
+    if (occlusionCulling) {
+        occlusion.IssueQueries(scene, camera.position, frustumInstances, view, projection);
+        result.occlusionQueries = occlusion.GetQueriesIssued();
+    }
+
+    //-----------------------------------
+    // 2. Deferred Lighting Pass
+    //-----------------------------------
+    profiler.Begin(GPU_PASS_LIGHTING);
+    if (result.deferredCount > 0 && lightingPath == LIGHTING_VOLUMES) {
+        glDisable(GL_DEPTH_TEST);
+        lightVolumes.Render(scene, gbuffer, quad, view, projection, camera.position, targetFBO);
+        glEnable(GL_DEPTH_TEST);
+    } else if (result.deferredCount > 0) {
+        glDisable(GL_DEPTH_TEST);
+
+        Shader& shader = lightingPath == LIGHTING_TILED ? tiledLightingShader : lightingShader;
+        if (lightingPath == LIGHTING_TILED) {
+            tiledLighting.Build(scene, gbuffer, quad, view, projection);
+            result.tileLightIndices = tiledLighting.GetLightIndexCount();
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+        glViewport(0, 0, width, height);
+
+        gbuffer.BindForReading();
+
+        shader.Use();
+        shader.SetValue("viewPos", camera.position);
+        scene.SetLights(shader);
+        gbuffer.BindTextures(shader);
+        if (gbuffer.layout != GBUFFER_FULL) {
+            shader.SetValue("inverseViewProjection", glm::inverse(projection * view));
+        }
+        if (gbuffer.layout == GBUFFER_MATERIAL_ID) {
+            scene.SetMaterials(shader);
+        }
+        if (lightingPath == LIGHTING_TILED) {
+            tiledLighting.Bind(shader);
+        }
+        quad.Draw();
+
+        glEnable(GL_DEPTH_TEST);
+    } else {
+        // Skip lighting pass if no deferred objects
+        glBindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+        glViewport(0, 0, width, height);
+    }
+    profiler.End(GPU_PASS_LIGHTING);
+
+    //-----------------------------------
+    // 3. Forward Pass
+    //-----------------------------------
+    profiler.Begin(GPU_PASS_FORWARD);
+    // Forward meshes test against the deferred geometry's depth, so fragments hidden behind
+    // it are rejected before shading (and no longer drawn over it). Both depth buffers are
+    // DEPTH24_STENCIL8, which the blit requires.
+    if (shareDepth && result.deferredCount > 0 && !renderQueue.GetForwardInstances().empty()) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, gbuffer.GetFBO());
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, targetFBO);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+    }
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    forwardQueryIssued = countForwardFragments;
+    if (countForwardFragments) {
+        glBeginQuery(GL_SAMPLES_PASSED, forwardQuery);
+    }
+
+    forward.Use();
+    forward.SetValue("view", view);
+    forward.SetValue("projection", projection);
+    forward.SetValue("viewPos", camera.position);
+    if (clustered) {
+        clusteredLighting.Build(scene, view, projection);
+        clusteredLighting.Bind(forward);
+        result.clusterLightIndices = clusteredLighting.GetLightIndexCount();
+    }
+
+    if (merged) {
+        scene.SetLights(forward);
+        result.forwardCount = geometryArena.Draw(forward, GeometryArena::PASS_FORWARD, renderQueue.GetForwardInstances());
+        result.drawCalls += result.forwardCount > 0 ? 1 : 0;
+    } else {
+        result.forwardCount = scene.DrawForward(forward, renderQueue.GetForwardInstances(), &result.drawCalls,
+                                                &result.triangles);
+    }
+
+    if (countForwardFragments) {
+        glEndQuery(GL_SAMPLES_PASSED);
+    }
+    glDisable(GL_BLEND);
+    profiler.End(GPU_PASS_FORWARD);
+
+    profiler.EndFrame();
+    frameIndex++;
+    result.uniforms = Shader::frameStats;
+    return result;
+}
+
+std::string ReadTextFile(const std::string& fileName){
+    std::ifstream file(fileName);
+
+    std::stringstream ss{};
+    ss << file.rdbuf();
+    file.close();
+
+    return ss.str();
+}
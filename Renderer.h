@@ -0,0 +1,128 @@
+#pragma once
+
+#include "Shader.h"
+#include "Camera.h"
+#include "Scene.h"
+#include "GBuffer.h"
+#include "Quad.h"
+#include "TiledLighting.h"
+#include "ClusteredLighting.h"
+#include "LightVolumes.h"
+#include "OcclusionCulling.h"
+#include "RenderQueue.h"
+#include "GeometryArena.h"
+#include "AdaptiveHybrid.h"
+#include "GpuProfiler.h"
+#include "OverdrawMetrics.h"
+
+#include <string>
+#include <GL/glew.h>
+
+std::string ReadTextFile(const std::string& fileName);
+
+// How the deferred lighting pass gathers lights
+enum LightingPath{
+    LIGHTING_FULLSCREEN, // Every pixel loops over every light
+    LIGHTING_TILED,      // Every pixel loops over its screen tile's light list
+    LIGHTING_VOLUMES     // A stencil/depth-culled sphere is rasterized per light
+};
+
+// How the forward pass gathers lights
+enum ForwardLighting{
+    FORWARD_ALL_LIGHTS, // Every fragment loops over every light
+    FORWARD_CLUSTERED   // Every fragment loops over its froxel's light list
+};
+
+// Owns the G-buffer, fullscreen quad and the three shader programs, and records
+// one hybrid frame (G-buffer -> deferred lighting -> forward) into a target framebuffer.
+// Shared by the interactive window (3DRenderer.cpp) and the headless benchmark.
+class Renderer{
+public:
+    struct FrameResult {
+        int deferredCount; // Mesh instances drawn into the G-buffer
+        int forwardCount;  // Mesh instances drawn in the forward pass
+        int visibleMeshes; // Instances that passed frustum culling
+        int culledMeshes;  // Instances rejected by frustum culling
+        int occludedMeshes; // Frustum-visible instances skipped by occlusion culling
+        size_t occlusionQueries; // Bounding-box queries issued this frame
+        size_t materialChanges; // Material uniform sets after render-queue sorting
+        int drawCalls;          // Mesh draw calls issued by the G-buffer and forward passes (one per instanced run)
+        size_t triangles;       // Triangles submitted by the per-mesh G-buffer and forward passes
+        size_t tileLightIndices; // Tiled path: total length of all tile light lists
+        size_t clusterLightIndices; // Clustered forward: total length of all cluster light lists
+        Shader::UniformStats uniforms; // Uniform traffic issued by this frame
+    };
+
+    Renderer(int width, int height, GBufferLayout gbufferLayout = GBUFFER_FULL);
+    ~Renderer();
+    Renderer(const Renderer&) = delete;
+    Renderer& operator=(const Renderer&) = delete;
+
+    // Classify meshes for the given mode and set the per-scene shader constants
+    // (ambient, exposure). Call once after the scene is loaded.
+    void Prepare(Scene& scene, Mode mode);
+
+    // Render one frame from the given camera into targetFBO (0 = default framebuffer)
+    FrameResult RenderFrame(const Scene& scene, Camera& camera, GLuint targetFBO = 0);
+
+    // Samples that passed the depth test in the last frame's forward pass (countForwardFragments).
+    // Waits for the query, so call it after the frame has been timed.
+    size_t GetForwardFragments() const;
+
+    // Feed the pass times the profiler read back since the last call to the adaptive controller,
+    // which may move a material group between the paths (adaptiveHybrid, hybrid mode). Call once per frame
+    void Adapt(Scene& scene);
+
+    // Hybrid mode with overdrawRefreshFrames > 0: apply an overdraw measurement that has
+    // finished since the last call, or issue a new one from camera once the interval has
+    // passed. Never waits for the GPU. Call once per frame, before RenderFrame
+    void RefreshRenderingMode(Scene& scene, Camera& camera);
+
+    size_t GetFrameIndex() const { return frameIndex; } // RenderFrame calls so far
+
+    // Exposure used for tone mapping, chosen from the scene's light count
+    static float ExposureForLightCount(size_t numLights);
+
+    int width, height;
+    LightingPath lightingPath = LIGHTING_FULLSCREEN;
+    ForwardLighting forwardLighting = FORWARD_ALL_LIGHTS;
+    bool occlusionCulling = false; // Skip meshes found hidden by last frame's queries
+    bool mergedGeometry = false;   // Draw from the shared GeometryArena (built by Prepare)
+    bool levelOfDetail = true;     // Pick each instance's LOD from its projected size (per-mesh path only)
+    bool shareDepth = true;        // Copy the G-buffer depth into the target before the forward pass
+    bool countForwardFragments = false; // Wrap the forward pass in a samples-passed query
+    bool timePasses = false;       // Time each pass with the profiler (implied by adaptiveHybrid)
+    bool adaptiveHybrid = false;   // Keep re-trialling the hybrid split from measured pass times (Adapt)
+    // Frames between hybrid re-measurements (RefreshRenderingMode); 0 = Prepare only. Ignored
+    // while adaptiveHybrid is on: reclassifying would discard the moves the controller kept
+    int overdrawRefreshFrames = 0;
+
+    Quad quad;
+    GBuffer gbuffer;
+    Shader gbufferShader;
+    Shader lightingShader;
+    Shader forwardShader;
+    Shader tiledLightingShader; // lighting_frag.glsl built with TILED_LIGHTING
+    TiledLighting tiledLighting;
+    Shader clusteredForwardShader; // forward_fragment.glsl built with CLUSTERED_LIGHTING
+    ClusteredLighting clusteredLighting;
+    LightVolumes lightVolumes;
+    OcclusionCulling occlusion;
+    RenderQueue renderQueue;
+    GeometryArena geometryArena;
+    Shader gbufferMergedShader;           // MERGED_GEOMETRY variants of the mesh shaders
+    Shader forwardMergedShader;
+    Shader clusteredForwardMergedShader;
+    AdaptiveHybrid adaptive;
+    GpuProfiler profiler;
+    OverdrawMetrics overdraw; // Persistent target and queries of the hybrid measurement
+
+private:
+    std::vector<uint32_t> frustumInstances; // Frustum culling result, reused across frames
+    std::vector<uint32_t> visibleInstances; // Instances drawn this frame (after occlusion culling)
+    GLuint forwardQuery;                    // GL_SAMPLES_PASSED over the forward pass
+    bool forwardQueryIssued = false;
+    size_t frameIndex = 0;
+    Mode preparedMode = HYBRID;
+    size_t overdrawIssueFrame = 0; // Frame the last refresh measurement was issued before
+};
@@ -1,9 +1,17 @@
 #include "Scene.h"
+#include "SceneCache.h"
+#include "OverdrawMetrics.h"
 
 #include <iostream>
 #include <algorithm>
 #include <cmath>
 #include <cfloat>
+#include <cstdint>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
 #include <SFML/System.hpp>
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
@@ -15,26 +23,91 @@ float Scene::HIGH_OVERDRAW_THRESHOLD = 2.0f;
 float Scene::LOW_OVERDRAW_THRESHOLD = 1.2f;
 size_t Scene::SMALL_MESH_THRESHOLD = 50;
 size_t Scene::FEW_LIGHTS_THRESHOLD = 8;
+float Scene::FAR_DISTANCE_THRESHOLD = 200.0f; // Bounding radii
+size_t Scene::LARGE_MESH_THRESHOLD = 2000;    // Triangles
 float Scene::LOW_SCENE_COVERAGE_THRESHOLD = 0.3f; // 30% of screen
+CostModel Scene::COST_MODEL;
+
+const unsigned int Scene::IMPORT_FLAGS = aiProcess_Triangulate;
+int Scene::IMPORT_THREADS = 0;
+bool Scene::OPTIMIZE_MESHES = true;
+bool Scene::GENERATE_LODS = true;
+bool Scene::LOG_CLASSIFICATION = false;
+float Scene::LOD_PIXEL_ERROR = 1.0f;
+VertexFormat Scene::VERTEX_FORMAT = VERTEX_FLOAT;
+
+// Milliseconds since start
+static float ElapsedMs(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static uint64_t nextSceneId = 1; // 0 stays free for "no scene"
+
+Scene::Scene(const std::string& fileName, bool keepCpuGeometry, SceneCacheMode cacheMode) 
+    : camera(glm::vec3(0.0f, 0.0f, 10.0f)), id(nextSceneId++), keepCpuGeometry(keepCpuGeometry), loadedFromCache(false) {
+    auto loadStart = std::chrono::steady_clock::now();
+    std::string cachePath = SceneCache::PathFor(fileName);
 
+    if (cacheMode == CACHE_USE) {
+        loadedFromCache = SceneCache::Load(cachePath, fileName, IMPORT_FLAGS, *this);
+        importStats.cacheMs = ElapsedMs(loadStart);
+    }
+    if (!loadedFromCache) {
+        // Compressed buffers read back lossily, so the cache is written from the float arrays
+        bool keepForCache = cacheMode == CACHE_REBUILD && VERTEX_FORMAT == VERTEX_COMPRESSED && !keepCpuGeometry;
+        this->keepCpuGeometry = keepCpuGeometry || keepForCache;
+        if (!Import(fileName)) return;
+
+        if (cacheMode == CACHE_REBUILD && SceneCache::Write(cachePath, fileName, IMPORT_FLAGS, *this)) {
+            std::cout << "Wrote scene cache " << cachePath << std::endl;
+        }
+        if (keepForCache) {
+            this->keepCpuGeometry = false;
+            for (Mesh& mesh : meshes) mesh.ReleaseCpuGeometry();
+        }
+    }
 
-Scene::Scene(const std::string& fileName) 
-    : camera(glm::vec3(0.0f, 0.0f, 10.0f)) {
+    camera.UpdateDirectionVectors();
+    lightBuffer.Upload(lights);
+    materialBuffer.Upload(materials);
+    instanceLods.assign(instances.size(), 0);
+
+    // Static scene: build the culling hierarchy once over world-space instance bounds
+    auto boundsStart = std::chrono::steady_clock::now();
+    bvh.Build(worldBoundsMin, worldBoundsMax);
+    importStats.boundsMs += ElapsedMs(boundsStart);
+    importStats.totalMs = ElapsedMs(loadStart);
+        
+    // Note: UpdateRenderingMode will be called after shaders are created
+    // (called from main after gbufferShader is available)
+}
+
+bool Scene::Import(const std::string& fileName){
+    auto stageStart = std::chrono::steady_clock::now();
     Assimp::Importer importer;
-    importer.ReadFile(fileName, aiProcess_Triangulate);
+    importer.ReadFile(fileName, IMPORT_FLAGS);
+    importStats.readMs = ElapsedMs(stageStart);
 
     const aiScene* scene = importer.GetScene();
 
     if (!scene || !scene->mRootNode || (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE)){
         std::cerr << "Failed to load " << fileName << std::endl;
-        return;
+        return false;
     }
 
-    camera.UpdateDirectionVectors();
-
+    stageStart = std::chrono::steady_clock::now();
     std::unordered_map<std::string, glm::mat4> nodeTransformations;
-    processNode(scene->mRootNode, scene, glm::mat4(1.0f), nodeTransformations);
+    std::vector<int> meshLookup(scene->mNumMeshes, -1);
+    std::vector<unsigned int> uniqueMeshes;
+    uniqueMeshes.reserve(scene->mNumMeshes);
+    processNode(scene->mRootNode, scene, glm::mat4(1.0f), nodeTransformations, meshLookup, uniqueMeshes);
+    importStats.nodesMs = ElapsedMs(stageStart);
+
+    stageStart = std::chrono::steady_clock::now();
+    processMeshes(scene, uniqueMeshes);
+    importStats.meshesMs = ElapsedMs(stageStart);
 
+    stageStart = std::chrono::steady_clock::now();
     for (size_t i = 0; i < scene->mNumMaterials; i++){
         materials.push_back(processMaterials(scene->mMaterials[i]));
     }
@@ -62,89 +135,248 @@ Scene::Scene(const std::string& fileName)
             myLight.linear = light->mAttenuationLinear >= 0.0f ? light->mAttenuationLinear : 0.014f;
             myLight.quadratic = light->mAttenuationQuadratic >= 0.0f ? light->mAttenuationQuadratic : 0.0007f;
             
-            // Calculate light radius based on attenuation
-            // Radius is the distance at which light brightness drops to 5/256 (essentially invisible)
-            float lightMax = std::max({myLight.color.r, myLight.color.g, myLight.color.b});
-            if (myLight.quadratic > 0.0f && lightMax > 0.0f) {
-                float discriminant = myLight.linear * myLight.linear - 4.0f * myLight.quadratic * (myLight.constant - (256.0f / 5.0f) * lightMax);
-                if (discriminant >= 0.0f) {
-                    myLight.radius = (-myLight.linear + std::sqrt(discriminant)) / (2.0f * myLight.quadratic);
-                } else {
-                    myLight.radius = 1000.0f; // Fallback: very large radius if calculation fails
-                }
-            } else {
-                myLight.radius = 1000.0f; // Fallback: very large radius if quadratic is 0
-            }
+            myLight.radius = ComputeLightRadius(myLight);
 
             lights.push_back(myLight);
         }
     }
-        
-    // Note: UpdateRenderingMode will be called after shaders are created
-    // (called from main after gbufferShader is available)
+    importStats.materialsMs = ElapsedMs(stageStart);
+
+    stageStart = std::chrono::steady_clock::now();
+    worldBoundsMin.resize(instances.size());
+    worldBoundsMax.resize(instances.size());
+    for (size_t i = 0; i < instances.size(); i++){
+        GetWorldBounds(meshes[instances[i].mesh], instances[i].transformation, worldBoundsMin[i], worldBoundsMax[i]);
+    }
+    importStats.boundsMs = ElapsedMs(stageStart);
+    return true;
 }
 
-void Scene::SetLights(Shader& shader) const {
-    int i = 0;
-    for (const auto& light : lights){
-        shader.SetValue("lights[" + std::to_string(i) + "].position", light.position);
-        shader.SetValue("lights[" + std::to_string(i) + "].color", light.color);
-        shader.SetValue("lights[" + std::to_string(i) + "].constant", light.constant);
-        shader.SetValue("lights[" + std::to_string(i) + "].linear", light.linear);
-        shader.SetValue("lights[" + std::to_string(i) + "].quadratic", light.quadratic);
-        shader.SetValue("lights[" + std::to_string(i) + "].radius", light.radius);
-        i++;
-    }
-    shader.SetValue("numLights", i);
+Scene::MeshUniforms Scene::MeshUniforms::Resolve(const Shader& shader) {
+    MeshUniforms uniforms;
+    uniforms.instanceBase = shader.GetUniform<int>("instanceBase");
+    uniforms.positionOffset = shader.GetUniform<glm::vec3>("positionOffset");
+    uniforms.positionScale = shader.GetUniform<glm::vec3>("positionScale");
+    uniforms.diffuse = shader.GetUniform<glm::vec3>("material.diffuse");
+    uniforms.specular = shader.GetUniform<glm::vec3>("material.specular");
+    uniforms.shininess = shader.GetUniform<float>("material.shininess");
+    uniforms.opacity = shader.GetUniform<float>("material.opacity");
+    uniforms.materialIndex = shader.GetUniform<int>("materialIndex");
+    return uniforms;
 }
 
-int Scene::DrawForward(Shader& shader) const {
-    shader.Use();
-    SetLights(shader);
+void Scene::MeshUniforms::SetMaterial(Shader& shader, const Material& material) const {
+    shader.Set(diffuse, material.diffuse);
+    shader.Set(specular, material.specular);
+    shader.Set(shininess, material.shininess);
+    shader.Set(opacity, material.opacity);
+}
 
-    int count = 0;
-    for (const auto& mesh : meshes){
-        if (!mesh.useForward) 
-            continue; // SKIP deferred meshes
+float Scene::ComputeLightRadius(const Light& light){
+    // Radius is the distance at which light brightness drops to 5/256 (essentially invisible)
+    float lightMax = std::max({light.color.r, light.color.g, light.color.b});
+    if (light.quadratic > 0.0f && lightMax > 0.0f) {
+        float discriminant = light.linear * light.linear - 4.0f * light.quadratic * (light.constant - (256.0f / 5.0f) * lightMax);
+        if (discriminant >= 0.0f) {
+            return (-light.linear + std::sqrt(discriminant)) / (2.0f * light.quadratic);
+        }
+        return 1000.0f; // Fallback: very large radius if calculation fails
+    }
+    return 1000.0f; // Fallback: very large radius if quadratic is 0
+}
 
-        const Material& material = materials[mesh.materialIndex];
+void Scene::GetWorldBounds(const Mesh& mesh, const glm::mat4& transformation, glm::vec3& outMin, glm::vec3& outMax) {
+    outMin = glm::vec3(FLT_MAX);
+    outMax = glm::vec3(-FLT_MAX);
+    for (int c = 0; c < 8; c++){
+        glm::vec3 corner((c & 1) ? mesh.bboxMax.x : mesh.bboxMin.x,
+                         (c & 2) ? mesh.bboxMax.y : mesh.bboxMin.y,
+                         (c & 4) ? mesh.bboxMax.z : mesh.bboxMin.z);
+        glm::vec3 world = glm::vec3(transformation * glm::vec4(corner, 1.0f));
+        outMin = glm::min(outMin, world);
+        outMax = glm::max(outMax, world);
+    }
+}
+
+void Scene::GetBounds(glm::vec3& outMin, glm::vec3& outMax) const {
+    outMin = glm::vec3(FLT_MAX);
+    outMax = glm::vec3(-FLT_MAX);
+    for (size_t i = 0; i < instances.size(); i++){
+        outMin = glm::min(outMin, worldBoundsMin[i]);
+        outMax = glm::max(outMax, worldBoundsMax[i]);
+    }
+    if (instances.empty()){
+        outMin = outMax = glm::vec3(0.0f);
+    }
+}
+
+void Scene::SetLights(Shader& shader) const {
+    lightBuffer.Bind();
+    shader.SetValue("lightData", LightBuffer::TEXTURE_UNIT);
+    shader.SetValue("numLights", (int)lightBuffer.GetCount());
+}
+
+void Scene::SetMaterials(Shader& shader) const {
+    materialBuffer.Bind();
+    shader.SetValue("materialData", MaterialBuffer::TEXTURE_UNIT);
+}
 
-        shader.SetValue("model", mesh.transformation);
-        shader.SetValue("material.diffuse", material.diffuse);
-        shader.SetValue("material.specular", material.specular);
-        shader.SetValue("material.shininess", material.shininess);
-        shader.SetValue("material.opacity", material.opacity);
+void Scene::ReplaceLights(const std::vector<Light>& newLights){
+    lights = newLights;
+    lightBuffer.Upload(lights);
+}
 
-        mesh.Draw();
-        count++;
+int Scene::GetForwardInstanceCount() const {
+    int count = 0;
+    for (const auto& instance : instances){
+        if (instance.useForward)
+            count++;
     }
     return count;
 }
 
-int Scene::DrawDeferred(Shader& gbufferShader) const {
-    gbufferShader.Use();
+void Scene::CullInstances(const glm::mat4& view, const glm::mat4& projection, std::vector<uint32_t>& visibleInstances) const {
+    bvh.Cull(Frustum(projection * view), visibleInstances);
+}
 
-    int count = 0;
-    for (const auto& mesh : meshes) {
-        if (mesh.useForward)
-            continue; // SKIP forward-only meshes
+void Scene::SelectLods(const std::vector<uint32_t>& visibleInstances, const glm::vec3& cameraPosition,
+                       const glm::mat4& projection, int viewportHeight) const {
+    // Pixels per unit of world-space size at distance 1
+    float pixelsPerUnit = projection[1][1] * viewportHeight * 0.5f;
+    for (uint32_t index : visibleInstances) {
+        const Mesh& mesh = meshes[instances[index].mesh];
+        int lodCount = mesh.GetLodCount();
+        if (lodCount == 1) {
+            instanceLods[index] = 0;
+            continue;
+        }
 
-        const Material& material = materials[mesh.materialIndex];
+        // Bounding spheres of the world and local boxes; their ratio scales the local error
+        glm::vec3 worldCenter = (worldBoundsMin[index] + worldBoundsMax[index]) * 0.5f;
+        float worldRadius = glm::length(worldBoundsMax[index] - worldBoundsMin[index]) * 0.5f;
+        float localRadius = glm::length(mesh.bboxMax - mesh.bboxMin) * 0.5f;
+        float distance = glm::length(worldCenter - cameraPosition) - worldRadius; // To the sphere
+        if (distance <= 0.0f || localRadius <= 0.0f) {
+            instanceLods[index] = 0;
+            continue;
+        }
+        if (distance > FAR_DISTANCE_THRESHOLD * worldRadius) {
+            instanceLods[index] = (uint8_t)(lodCount - 1);
+            continue;
+        }
+
+        float errorToPixels = worldRadius / localRadius * pixelsPerUnit / distance;
+        int lod = 0;
+        while (lod + 1 < lodCount && mesh.GetLodError(lod + 1) * errorToPixels <= LOD_PIXEL_ERROR) lod++;
+        instanceLods[index] = (uint8_t)lod;
+    }
+}
 
-        gbufferShader.SetValue("model", mesh.transformation);
-        gbufferShader.SetValue("material.diffuse", material.diffuse);
-        gbufferShader.SetValue("material.specular", material.specular);
-        gbufferShader.SetValue("material.shininess", material.shininess);
+void Scene::ResetLods() const {
+    std::fill(instanceLods.begin(), instanceLods.end(), 0);
+}
+
+int Scene::DrawInstances(Shader& shader, const MeshUniforms& uniforms, const std::vector<uint32_t>& drawOrder,
+                         InstanceFilter filter, int* drawCalls, size_t* triangles) const {
+    // Gather the transforms in draw order so each run is contiguous in the buffer
+    instanceTransforms.clear();
+    instanceRuns.clear();
+    for (uint32_t index : drawOrder){
+        const MeshInstance& instance = instances[index];
+        if ((filter == DEFERRED_INSTANCES && instance.useForward) ||
+            (filter == FORWARD_INSTANCES && !instance.useForward))
+            continue;
 
-        mesh.Draw();
-        count++;
+        int lod = instanceLods[index];
+        if (instanceRuns.empty() || instanceRuns.back().mesh != instance.mesh || instanceRuns.back().lod != lod) {
+            instanceRuns.push_back({instance.mesh, lod, (int)instanceTransforms.size(), 0});
+        }
+        instanceRuns.back().count++;
+        instanceTransforms.push_back(instance.transformation);
     }
-    return count;
+    if (instanceRuns.empty()) return 0;
+
+    instanceBuffer.Upload(instanceTransforms);
+    instanceBuffer.Bind();
+    shader.SetValue("instanceData", InstanceBuffer::TEXTURE_UNIT);
+
+    size_t currentMaterial = SIZE_MAX;
+    for (const InstanceRun& run : instanceRuns){
+        const Mesh& mesh = meshes[run.mesh];
+        if (mesh.materialIndex != currentMaterial) {
+            uniforms.SetMaterial(shader, materials[mesh.materialIndex]);
+            shader.Set(uniforms.materialIndex, (int)mesh.materialIndex);
+            currentMaterial = mesh.materialIndex;
+        }
+        shader.Set(uniforms.positionOffset, mesh.GetPositionOffset());
+        shader.Set(uniforms.positionScale, mesh.GetPositionScale());
+        shader.Set(uniforms.instanceBase, run.first);
+        mesh.DrawInstanced(run.count, run.lod);
+        if (triangles) *triangles += mesh.GetLodTriangleCount(run.lod) * run.count;
+    }
+    if (drawCalls) *drawCalls += (int)instanceRuns.size();
+    return (int)instanceTransforms.size();
 }
 
+void Scene::DrawInstancesQueried(Shader& shader, const MeshUniforms& uniforms, const std::vector<uint32_t>& drawOrder,
+                                 const GLuint* queries) const {
+    instanceTransforms.clear();
+    for (uint32_t index : drawOrder){
+        instanceTransforms.push_back(instances[index].transformation);
+    }
+    if (instanceTransforms.empty()) return;
+
+    instanceBuffer.Upload(instanceTransforms);
+    instanceBuffer.Bind();
+    shader.SetValue("instanceData", InstanceBuffer::TEXTURE_UNIT);
+
+    size_t currentMaterial = SIZE_MAX;
+    for (size_t k = 0; k < drawOrder.size(); k++){
+        const Mesh& mesh = meshes[instances[drawOrder[k]].mesh];
+        if (mesh.materialIndex != currentMaterial) {
+            uniforms.SetMaterial(shader, materials[mesh.materialIndex]);
+            shader.Set(uniforms.materialIndex, (int)mesh.materialIndex);
+            currentMaterial = mesh.materialIndex;
+        }
+        shader.Set(uniforms.positionOffset, mesh.GetPositionOffset());
+        shader.Set(uniforms.positionScale, mesh.GetPositionScale());
+        shader.Set(uniforms.instanceBase, (int)k);
+        glBeginQuery(GL_SAMPLES_PASSED, queries[k]);
+        mesh.DrawInstanced(1, 0); // Full detail: the LODs of instances outside the last frustum are stale
+        glEndQuery(GL_SAMPLES_PASSED);
+    }
+}
+
+size_t Scene::GetGeometryBytes() const {
+    size_t bytes = 0;
+    for (const Mesh& mesh : meshes) bytes += mesh.GetGpuBytes();
+    return bytes;
+}
+
+size_t Scene::GetFloatLayoutGeometryBytes() const {
+    size_t bytes = 0;
+    for (const Mesh& mesh : meshes) bytes += mesh.GetFloatLayoutBytes();
+    return bytes;
+}
+
+int Scene::DrawForward(Shader& shader, const std::vector<uint32_t>& drawOrder, int* drawCalls, size_t* triangles) const {
+    shader.Use();
+    SetLights(shader);
+
+    MeshUniforms uniforms = MeshUniforms::Resolve(shader);
+    return DrawInstances(shader, uniforms, drawOrder, FORWARD_INSTANCES, drawCalls, triangles); // SKIP deferred instances
+}
+
+int Scene::DrawDeferred(Shader& gbufferShader, const std::vector<uint32_t>& drawOrder, int* drawCalls, size_t* triangles) const {
+    gbufferShader.Use();
+
+    MeshUniforms uniforms = MeshUniforms::Resolve(gbufferShader);
+    return DrawInstances(gbufferShader, uniforms, drawOrder, DEFERRED_INSTANCES, drawCalls, triangles); // SKIP forward-only instances
+}
 
 void Scene::processNode(aiNode* node, const aiScene* scene, glm::mat4 parentTransformation,
-    std::unordered_map<std::string, glm::mat4>& nodeTransformations){
+    std::unordered_map<std::string, glm::mat4>& nodeTransformations, std::vector<int>& meshLookup,
+    std::vector<unsigned int>& uniqueMeshes){
     glm::mat4 transformation{};
 
     transformation[0][0] = node->mTransformation.a1;  transformation[1][0] = node->mTransformation.a2;
@@ -159,14 +391,18 @@ void Scene::processNode(aiNode* node, const aiScene* scene, glm::mat4 parentTran
     transformation = parentTransformation * transformation;
     nodeTransformations[node->mName.data] = transformation;
 
+    // Each aiMesh is converted and uploaded once (processMeshes), however many nodes reference it
     for (size_t i = 0; i < node->mNumMeshes; i++){
-        Mesh mesh = processMesh(scene->mMeshes[node->mMeshes[i]]);
-        mesh.transformation = transformation;
-        meshes.push_back(mesh);
+        unsigned int aiMeshIndex = node->mMeshes[i];
+        if (meshLookup[aiMeshIndex] < 0) {
+            meshLookup[aiMeshIndex] = (int)uniqueMeshes.size();
+            uniqueMeshes.push_back(aiMeshIndex);
+        }
+        instances.push_back({(uint32_t)meshLookup[aiMeshIndex], transformation});
     }
 
     for (size_t i = 0; i < node->mNumChildren; i++){
-        processNode(node->mChildren[i], scene, transformation, nodeTransformations);
+        processNode(node->mChildren[i], scene, transformation, nodeTransformations, meshLookup, uniqueMeshes);
     }
 }
 
@@ -198,13 +434,12 @@ Material Scene::processMaterials(aiMaterial* mat){
     return material;
 }
 
-void Scene::UpdateRenderingMode(Shader& gbufferShader, int viewportWidth, int viewportHeight, Mode mode) {
+void Scene::UpdateRenderingMode(OverdrawMetrics& overdraw, Shader& gbufferShader, int viewportWidth, int viewportHeight,
+                                Mode mode, bool forwardCullsLights) {
     glm::mat4 view = camera.GetViewMatrix();
     glm::mat4 projection = camera.GetProjectionMatrix((float)viewportWidth, (float)viewportHeight);
     
-    // For hybrid mode, first calculate total scene screen coverage using bounding boxes
-    float totalSceneCoverage = 0.0f;
-    float totalOverdraw = 0.0f;
+    // For hybrid mode, first measure coverage and overdraw per instance and count the lights reaching each
     if (mode == HYBRID) {
         // float screenArea = (float)(viewportWidth * viewportHeight);
         // glm::mat4 mvp = projection * view;
@@ -271,225 +506,145 @@ void Scene::UpdateRenderingMode(Shader& gbufferShader, int viewportWidth, int vi
 
 
         // ------------------------------------------------------------ //
-        SceneMetrics sceneMetrics = MeasureOverdraw(gbufferShader, viewportWidth, viewportHeight, view, projection);
-        totalSceneCoverage = sceneMetrics.screenCoverage;
-        totalOverdraw = sceneMetrics.overdrawRatio;
+        SceneMetrics sceneMetrics;
+        overdraw.Issue(*this, gbufferShader, viewportWidth, viewportHeight, view, projection);
+        overdraw.Poll(sceneMetrics, true);
+        ApplyHybridMetrics(sceneMetrics, viewportWidth, viewportHeight, forwardCullsLights);
+        return;
     }
     
-    for (size_t i = 0; i < meshes.size(); i++) {
-        const Mesh& mesh = meshes[i];        
+    for (size_t i = 0; i < instances.size(); i++) {
+        instances[i].useForward = mode == FORWARD;
+    }
+}
 
-        if (mode == DEFERRED){
-            meshes[i].useForward = false; 
-            continue;
-        } else if (mode == FORWARD){
-            meshes[i].useForward = true;
-            continue;
-        }
-        
-        // Hybrid Otherwise
+void Scene::ApplyHybridMetrics(SceneMetrics& sceneMetrics, int viewportWidth, int viewportHeight,
+                               bool forwardCullsLights) {
+    CountInstanceLights(sceneMetrics);
+    sceneMetrics.forwardLights = forwardCullsLights ? 0 : (uint32_t)lights.size();
+
+    for (size_t i = 0; i < instances.size(); i++) {
+        const Mesh& mesh = meshes[instances[i].mesh];
         const Material& material = materials[mesh.materialIndex];
         
         // Use heuristic to determine rendering mode
-        meshes[i].useForward = ShouldUseForward(
+        instances[i].useForward = ShouldUseForward(
             material, 
             mesh.triangleCount,
-            lights.size(),
-            totalSceneCoverage,
-            totalOverdraw
+            sceneMetrics.instances[i],
+            sceneMetrics
         );
     }
+
+    // The full-screen lighting pass costs the same however few meshes are deferred, so
+    // check that the deferred ones save more than it costs (replaces the coverage threshold)
+    bool allForward = false;
+    if (COST_MODEL.valid) {
+        float savedNs = 0.0f;
+        for (size_t i = 0; i < instances.size(); i++) {
+            if (instances[i].useForward) continue;
+            const InstanceMetrics& metrics = sceneMetrics.instances[i];
+            float forwardLights = (float)(sceneMetrics.forwardLights > 0 ? sceneMetrics.forwardLights : metrics.lights);
+            savedNs += COST_MODEL.ForwardCost((float)metrics.fragments, forwardLights)
+                     - COST_MODEL.DeferredCost((float)metrics.fragments, (float)metrics.visiblePixels, (float)metrics.lights);
+        }
+        float lightingPassNs = COST_MODEL.lightingPerPixel * (float)viewportWidth * (float)viewportHeight;
+        allForward = savedNs < lightingPassNs;
+        if (allForward) {
+            for (MeshInstance& instance : instances) {
+                instance.useForward = true;
+            }
+        }
+    }
+
+    int forwardCount = GetForwardInstanceCount();
+    std::cout << "Hybrid: " << forwardCount << " forward / " << instances.size() - forwardCount << " deferred"
+              << (allForward ? " (deferring saves less than the lighting pass costs)" : "") << std::endl;
 }
 
-Mesh Scene::processMesh(aiMesh* mesh){
-    std::vector<Vertex> vertices;
-    std::vector<uint32_t> indices;
+void Scene::processMeshes(const aiScene* scene, const std::vector<unsigned int>& uniqueMeshes){
+    size_t jobCount = uniqueMeshes.size();
+    size_t workerCount = IMPORT_THREADS > 0 ? (size_t)IMPORT_THREADS : std::max(1u, std::thread::hardware_concurrency());
+    workerCount = std::min(workerCount, std::max<size_t>(jobCount, 1));
+    importStats.workerThreads = (int)workerCount;
+    meshes.reserve(jobCount);
+    meshOptimizationStats.assign(OPTIMIZE_MESHES ? jobCount : 0, MeshOptimizationStats());
+
+    // Workers claim meshes in order from a shared counter and publish them into their slot;
+    // the GL thread uploads slot after slot as soon as each one is ready
+    std::vector<MeshData> converted(jobCount);
+    std::vector<uint8_t> ready(jobCount, 0);
+    std::atomic<size_t> nextJob(0);
+    std::mutex readyMutex;
+    std::condition_variable readyCondition;
+
+    std::vector<std::thread> workers;
+    workers.reserve(workerCount);
+    for (size_t w = 0; w < workerCount; w++) {
+        workers.emplace_back([&]() {
+            for (size_t job = nextJob++; job < jobCount; job = nextJob++) {
+                MeshData data = processMesh(scene->mMeshes[uniqueMeshes[job]]);
+                if (OPTIMIZE_MESHES) meshOptimizationStats[job] = OptimizeMesh(data); // Own slot, no lock
+                if (GENERATE_LODS && data.indices.size() / 3 >= LARGE_MESH_THRESHOLD) GenerateLods(data);
+                std::lock_guard<std::mutex> lock(readyMutex);
+                converted[job] = std::move(data);
+                ready[job] = 1;
+                readyCondition.notify_one();
+            }
+        });
+    }
+
+    for (size_t slot = 0; slot < jobCount; slot++) {
+        MeshData data;
+        {
+            std::unique_lock<std::mutex> lock(readyMutex);
+            readyCondition.wait(lock, [&]() { return ready[slot] != 0; });
+            data = std::move(converted[slot]);
+        }
+        auto uploadStart = std::chrono::steady_clock::now();
+        meshes.emplace_back(std::move(data), keepCpuGeometry, VERTEX_FORMAT);
+        importStats.uploadMs += ElapsedMs(uploadStart);
+    }
 
-    // Compute bounding box center for distance calculations
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+MeshData Scene::processMesh(const aiMesh* mesh){
+    MeshData data;
+    data.materialIndex = mesh->mMaterialIndex;
+    data.vertices.resize(mesh->mNumVertices);
+
+    // Compute bounding box for culling and distance calculations
     glm::vec3 minPos(FLT_MAX), maxPos(-FLT_MAX);
 
     for (size_t i = 0; i < mesh->mNumVertices; i++){
-        Vertex vertex{};
-        aiVector3D pos = mesh->mVertices[i];
-        aiVector3D norm = mesh->mNormals[i];
+        const aiVector3D& pos = mesh->mVertices[i];
+        const aiVector3D& norm = mesh->mNormals[i];
+        Vertex& vertex = data.vertices[i];
         vertex.position = glm::vec3(pos.x, pos.y, pos.z);
         vertex.normal = glm::vec3(norm.x, norm.y, norm.z);
 
-        // Update bounding box
-        minPos.x = std::min(minPos.x, vertex.position.x);
-        minPos.y = std::min(minPos.y, vertex.position.y);
-        minPos.z = std::min(minPos.z, vertex.position.z);
-        maxPos.x = std::max(maxPos.x, vertex.position.x);
-        maxPos.y = std::max(maxPos.y, vertex.position.y);
-        maxPos.z = std::max(maxPos.z, vertex.position.z);
-
-        vertices.push_back(vertex);
+        minPos = glm::min(minPos, vertex.position);
+        maxPos = glm::max(maxPos, vertex.position);
     }
 
+    // Triangulated on import, but stay safe with the actual face sizes
+    size_t indexCount = 0;
     for (size_t i = 0; i < mesh->mNumFaces; i++){
-        aiFace face = mesh->mFaces[i];
-        for (size_t i = 0; i < face.mNumIndices; i++){
-            indices.push_back(face.mIndices[i]);
-        }
+        indexCount += mesh->mFaces[i].mNumIndices;
     }
-
-    Mesh result(vertices, indices, mesh->mMaterialIndex);
-    result.center = (minPos + maxPos) * 0.5f; // Bounding box center
-    result.bboxMin = minPos;
-    result.bboxMax = maxPos; 
-    return result;
-}
-
-Scene::SceneMetrics Scene::MeasureOverdraw(Shader& shader, int viewportWidth, int viewportHeight,
-                                           const glm::mat4& view, const glm::mat4& projection) const {
-    SceneMetrics metrics;
-    
-    // ============================================
-    // SAVE CURRENT OPENGL STATE
-    // ============================================
-    GLint oldViewport[4];
-    GLint oldDrawBuffer, oldReadBuffer;
-    GLint oldFBO;
-    GLboolean oldDepthTest, oldDepthMask;
-    GLint oldDepthFunc;
-    
-    glGetIntegerv(GL_VIEWPORT, oldViewport);
-    glGetIntegerv(GL_DRAW_BUFFER, &oldDrawBuffer);
-    glGetIntegerv(GL_READ_BUFFER, &oldReadBuffer);
-    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &oldFBO);
-    oldDepthTest = glIsEnabled(GL_DEPTH_TEST);
-    glGetBooleanv(GL_DEPTH_WRITEMASK, &oldDepthMask);
-    glGetIntegerv(GL_DEPTH_FUNC, &oldDepthFunc);
-    
-    // ============================================
-    // SETUP TEMPORARY FBO
-    // ============================================
-    
-    GLuint fbo, depthRB, colorTex = 0;
-    GLboolean oldColorMask[4] = {GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE};
-    
-    glGenFramebuffers(1, &fbo);
-    glGenRenderbuffers(1, &depthRB);
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-    
-    // Apple Silicon: no color attachment needed
-    glDrawBuffer(GL_NONE);
-    glReadBuffer(GL_NONE);
-    
-    // Depth buffer
-    glBindRenderbuffer(GL_RENDERBUFFER, depthRB);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, viewportWidth, viewportHeight);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRB);
-    
-    glViewport(0, 0, viewportWidth, viewportHeight);
-    
-    // Setup shader
-    shader.Use();
-    shader.SetValue("view", view);
-    shader.SetValue("projection", projection);
-    
-    // Generate query objects
-    GLuint queryTotal, queryVisible;
-    glGenQueries(1, &queryTotal);
-    glGenQueries(1, &queryVisible);
-    
-    // ============================================
-    // PASS 1: Count total fragments (with overdraw)
-    // ============================================
-    glClear(GL_DEPTH_BUFFER_BIT);
-
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LESS);
-    glDepthMask(GL_TRUE);  // Write depth
-    
-    glBeginQuery(GL_SAMPLES_PASSED, queryTotal);
-    for (const auto& mesh : meshes) {
-        const Material& material = materials[mesh.materialIndex];
-        shader.SetValue("model", mesh.transformation);
-        shader.SetValue("material.diffuse", material.diffuse);
-        shader.SetValue("material.specular", material.specular);
-        shader.SetValue("material.shininess", material.shininess);
-        mesh.Draw();
+    data.indices.resize(indexCount);
+    uint32_t* out = data.indices.data();
+    for (size_t i = 0; i < mesh->mNumFaces; i++){
+        const aiFace& face = mesh->mFaces[i];
+        out = std::copy(face.mIndices, face.mIndices + face.mNumIndices, out);
     }
-    glEndQuery(GL_SAMPLES_PASSED);
-    
-    // ============================================
-    // PASS 2: Count visible pixels (unique pixels, no overdraw)
-    // ============================================
-    // Don't clear depth - reuse from pass 1
-    // Use GL_LEQUAL to count fragments at equal depth (the first fragment per pixel)
-    glDepthFunc(GL_LEQUAL);
-    glDepthMask(GL_FALSE);   // Don't write depth, but still test
-    
 
-    glBeginQuery(GL_SAMPLES_PASSED, queryVisible);
-    for (const auto& mesh : meshes) {
-        const Material& material = materials[mesh.materialIndex];
-        shader.SetValue("model", mesh.transformation);
-        shader.SetValue("material.diffuse", material.diffuse);
-        shader.SetValue("material.specular", material.specular);
-        shader.SetValue("material.shininess", material.shininess);
-        mesh.Draw();
-    }
-    glEndQuery(GL_SAMPLES_PASSED);
-    
-    // ============================================
-    // GET QUERY RESULTS
-    // ============================================
-    GLuint totalFragments = 0;
-    GLuint visiblePixels = 0;
-    
-    // Wait for results (queries are async)
-    glGetQueryObjectuiv(queryTotal, GL_QUERY_RESULT, &totalFragments);
-    glGetQueryObjectuiv(queryVisible, GL_QUERY_RESULT, &visiblePixels);
-    
-    // ============================================
-    // CLEANUP AND RESTORE STATE
-    // ============================================
-    glDeleteQueries(1, &queryTotal);
-    glDeleteQueries(1, &queryVisible);
-    
-    // Delete temporary FBO resources
-    glDeleteFramebuffers(1, &fbo);
-    glDeleteRenderbuffers(1, &depthRB);
-    
-    // RESTORE ALL OPENGL STATE
-    glBindFramebuffer(GL_FRAMEBUFFER, oldFBO);
-    glViewport(oldViewport[0], oldViewport[1], oldViewport[2], oldViewport[3]);
-    
-    // Restore draw/read buffers
-    if (oldFBO == 0) {
-        // Default framebuffer
-        glDrawBuffer(oldDrawBuffer);
-        glReadBuffer(oldReadBuffer);
-    } else {
-        // FBO - restore draw buffers
-        glDrawBuffer(oldDrawBuffer);
-        glReadBuffer(oldReadBuffer);
-    }
-    
-    // Restore depth state
-    if (oldDepthTest) {
-        glEnable(GL_DEPTH_TEST);
-    } else {
-        glDisable(GL_DEPTH_TEST);
-    }
-    glDepthMask(oldDepthMask);
-    glDepthFunc(oldDepthFunc);
-    
-    // ============================================
-    // CALCULATE METRICS
-    // ============================================
-    float screenArea = (float)(viewportWidth * viewportHeight);
-    if (visiblePixels == 0) {
-        metrics.overdrawRatio = 1.0f;
-        metrics.screenCoverage = 0.0f;
-    } else {
-        metrics.overdrawRatio = (float)totalFragments / (float)visiblePixels;
-        metrics.screenCoverage = (float)visiblePixels / screenArea;
-    }
-    
-    return metrics;
+    data.bboxMin = minPos;
+    data.bboxMax = maxPos;
+    return data;
 }
 
 // Scene::SceneMetrics Scene::MeasureOverdraw(Shader& shader, int viewportWidth, int viewportHeight,
@@ -594,37 +749,73 @@ Scene::SceneMetrics Scene::MeasureOverdraw(Shader& shader, int viewportWidth, in
 //     return metrics;
 // }
 
+void Scene::CountInstanceLights(SceneMetrics& metrics) const {
+    metrics.instances.resize(instances.size());
+    std::vector<uint32_t> touched;
+    for (const Light& light : lights) {
+        bvh.QuerySphere(light.position, light.radius, touched);
+        for (uint32_t i : touched) {
+            metrics.instances[i].lights++;
+        }
+    }
+}
+
 bool Scene::ShouldUseForward(const Material& material, size_t triangleCount,
-                             size_t numLights, float totalSceneCoverage, float totalOverdraw) {
+                             const InstanceMetrics& instance, const SceneMetrics& scene) {
     // 1. TRANSPARENCY: Must use forward for transparent objects
     // This is the most important check - deferred can't handle transparency properly
     if (material.opacity < 1.0f) {
-        std::cout << "Transparent Object --> Forward" << std::endl;
+        if (LOG_CLASSIFICATION) std::cout << "Transparent Object --> Forward" << std::endl;
         return true;
     }
     
-    // 2. LOW SCENE COVERAGE: If the scene as a whole has low screen coverage, use forward
+    // 2. MEASURED COSTS: Put the mesh on whichever path the device's cost model prices lower.
+    // Meshes outside the measuring frustum are priced per pixel at the scene's overdraw
+    if (COST_MODEL.valid) {
+        float fragments = (float)instance.fragments, visiblePixels = (float)instance.visiblePixels;
+        if (instance.fragments == 0) {
+            fragments = scene.overdrawRatio;
+            visiblePixels = 1.0f;
+        }
+        float forwardLights = (float)(scene.forwardLights > 0 ? scene.forwardLights : instance.lights);
+        float forwardNs = COST_MODEL.ForwardCost(fragments, forwardLights);
+        float deferredNs = COST_MODEL.DeferredCost(fragments, visiblePixels, (float)instance.lights);
+        if (forwardNs < deferredNs) {
+            return true;
+        }
+        return false;
+    }
+
+    // 3. LOW SCENE COVERAGE: If the scene as a whole has low screen coverage, use forward
     // Deferred rendering overhead (G-buffer writes) is not worth it for sparse scenes
-    if (totalSceneCoverage < LOW_SCENE_COVERAGE_THRESHOLD) {
-        std::cout << "Low Scene Coverage: " << (totalSceneCoverage * 100.0f) << "% --> Forward" << std::endl;
+    if (scene.screenCoverage < LOW_SCENE_COVERAGE_THRESHOLD) {
+        if (LOG_CLASSIFICATION) std::cout << "Low Scene Coverage: " << (scene.screenCoverage * 100.0f) << "% --> Forward" << std::endl;
         return true;
     }
 
-    if (totalOverdraw < LOW_OVERDRAW_THRESHOLD){
-        std::cout << "Low Overdraw: " << (totalOverdraw) << "x --> Forward" << std::endl;
+    // Fragments this mesh shaded per pixel it ends up covering: forward shades every one of
+    // them, deferred lights each covered pixel once. Hidden meshes count as heavily overdrawn
+    float overdraw = scene.overdrawRatio;
+    if (instance.visiblePixels > 0) {
+        overdraw = (float)instance.fragments / (float)instance.visiblePixels;
+    } else if (instance.fragments > 0) {
+        overdraw = HIGH_OVERDRAW_THRESHOLD;
+    }
+    if (overdraw < LOW_OVERDRAW_THRESHOLD){
+        if (LOG_CLASSIFICATION) std::cout << "Low Overdraw: " << (overdraw) << "x --> Forward" << std::endl;
         return true;
     }
     
-    // 3. SMALL MESHES: Very small meshes are better in forward
+    // 4. SMALL MESHES: Very small meshes are better in forward
     // Writing to multiple render targets has overhead, so small meshes benefit from forward
     // if (triangleCount < SMALL_MESH_THRESHOLD) {
     //     std::cout << "Small Mesh: " << triangleCount <<" triangles --> Forward" << std::endl;
     //     return true;
     // }
     
-    if (numLights <= FEW_LIGHTS_THRESHOLD) {
-        // Few lights: forward is better (less overhead)
-        std::cout << "Few Lights: " << numLights << " --> Forward" << std::endl;
+    if (instance.lights <= FEW_LIGHTS_THRESHOLD) {
+        // Few lights reach this mesh: forward is better (less overhead)
+        if (LOG_CLASSIFICATION) std::cout << "Few Lights: " << instance.lights << " --> Forward" << std::endl;
         return true;
     }
     
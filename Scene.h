@@ -1,14 +1,23 @@
 #pragma once
 
 #include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
 #include "Shader.h"
 #include "Camera.h"
+#include "LightBuffer.h"
+#include "MaterialBuffer.h"
+#include "MeshBVH.h"
+#include "InstanceBuffer.h"
+#include "CostModel.h"
 
 #include <string>
 #include <unordered_map>
 #include <assimp/scene.h>
 #include <GL/glew.h>
 
+class OverdrawMetrics;
+
 struct Material{
     glm::vec3 diffuse;
     glm::vec3 specular;
@@ -25,6 +34,19 @@ struct Light{
     float radius = 0.0f;      // Light volume radius (calculated from attenuation)
 };
 
+// One node's reference to a shared Mesh
+struct MeshInstance{
+    uint32_t mesh; // Index into the scene's unique meshes
+    glm::mat4 transformation;
+    bool useForward = false; // Whether to use forward rendering for this instance
+};
+
+enum SceneCacheMode{
+    CACHE_OFF,     // Always import with Assimp
+    CACHE_USE,     // Load <file>.scenecache if it matches the source, otherwise import
+    CACHE_REBUILD  // Import with Assimp and (re)write the cache
+};
+
 enum Mode{
     DEFERRED,
     FORWARD, 
@@ -33,51 +55,190 @@ enum Mode{
 
 class Scene{
 public:
-    Scene(const std::string& fileName);
-    int DrawForward(Shader& shader) const; // Returns number of objects rendered
-    int DrawDeferred(Shader& shader) const; // Returns number of objects rendered 
-    void SetLights(Shader& shader) const;
+    // keepCpuGeometry retains each mesh's vertex/index arrays after the GL upload
+    Scene(const std::string& fileName, bool keepCpuGeometry = false, SceneCacheMode cacheMode = CACHE_USE);
+    bool LoadedFromCache() const { return loadedFromCache; }
+    uint64_t GetId() const { return id; } // Unique per constructed scene, never reused
+
+    // Wall-clock time of each load stage; the Assimp stages stay zero on a cache hit
+    struct ImportStats {
+        float readMs = 0.0f;      // Assimp ReadFile
+        float nodesMs = 0.0f;     // Node walk: instances and unique meshes
+        float meshesMs = 0.0f;    // Parallel mesh conversion and optimization overlapped with GL upload
+        float uploadMs = 0.0f;    // Main-thread time in GL uploads (part of meshesMs)
+        float materialsMs = 0.0f; // Materials and lights
+        float boundsMs = 0.0f;    // World-space instance bounds and BVH
+        float cacheMs = 0.0f;     // SceneCache load (replaces the Assimp stages)
+        float totalMs = 0.0f;
+        int workerThreads = 0;    // Mesh conversion workers used
+    };
+    const ImportStats& GetImportStats() const { return importStats; }
+    // Per-mesh welding/reordering results of the last import (meshes order); empty
+    // after a cache hit or with OPTIMIZE_MESHES off
+    const std::vector<MeshOptimizationStats>& GetMeshOptimizationStats() const { return meshOptimizationStats; }
+    // Draw the forward/deferred instances of drawOrder in that order (e.g. from RenderQueue).
+    // Consecutive instances of the same mesh share one glDrawElementsInstanced call, and
+    // material uniforms are set only when the material changes. Returns number of instances
+    // rendered; adds the number of draw calls issued to drawCalls and the triangles
+    // submitted (at each instance's selected LOD) to triangles if given
+    int DrawForward(Shader& shader, const std::vector<uint32_t>& drawOrder, int* drawCalls = nullptr,
+                    size_t* triangles = nullptr) const;
+    int DrawDeferred(Shader& shader, const std::vector<uint32_t>& drawOrder, int* drawCalls = nullptr,
+                     size_t* triangles = nullptr) const;
+    // Frustum-cull all instances through the BVH; fills ascending instance indices
+    void CullInstances(const glm::mat4& view, const glm::mat4& projection, std::vector<uint32_t>& visibleInstances) const;
+    // Pick the level of detail the given instances are drawn with: the coarsest one whose
+    // error, projected from the instance's distance, stays under LOD_PIXEL_ERROR pixels
+    // (or the coarsest at all beyond FAR_DISTANCE_THRESHOLD bounding radii)
+    void SelectLods(const std::vector<uint32_t>& visibleInstances, const glm::vec3& cameraPosition,
+                    const glm::mat4& projection, int viewportHeight) const;
+    void ResetLods() const; // Every instance back to level 0
+    int GetInstanceLod(size_t i) const { return instanceLods[i]; }
+    size_t GetMeshCount() const { return meshes.size(); } // Unique meshes (one per aiMesh)
+    const Mesh& GetMesh(size_t i) const { return meshes[i]; }
+    size_t GetInstanceCount() const { return instances.size(); }
+    const MeshInstance& GetInstance(size_t i) const { return instances[i]; }
+    const Material& GetMaterial(size_t i) const { return materials[i]; }
+    // World-space AABB of instance i (computed once at load)
+    const glm::vec3& GetInstanceBoundsMin(size_t i) const { return worldBoundsMin[i]; }
+    const glm::vec3& GetInstanceBoundsMax(size_t i) const { return worldBoundsMax[i]; }
+    void SetLights(Shader& shader) const; // Binds the light buffer and sets numLights
+    void SetMaterials(Shader& shader) const; // Binds the material table (material-ID G-buffer)
+    int GetForwardInstanceCount() const; // Instances currently assigned to the forward pass
+    void SetInstanceForward(size_t i, bool useForward) { instances[i].useForward = useForward; }
     size_t GetLightCount() const { return lights.size(); }
+    const std::vector<Light>& GetLights() const { return lights; }
+    void ReplaceLights(const std::vector<Light>& newLights); // Re-uploads the light buffer
+    static float ComputeLightRadius(const Light& light); // Distance where attenuation reaches 5/256
+
+    // World-space bounds of all instances
+    void GetBounds(glm::vec3& outMin, glm::vec3& outMax) const;
     
     // Global thresholds for rendering heuristics
     static float HIGH_OVERDRAW_THRESHOLD;
     static float LOW_OVERDRAW_THRESHOLD;
     static size_t SMALL_MESH_THRESHOLD;
-    static float FAR_DISTANCE_THRESHOLD;
+    static float FAR_DISTANCE_THRESHOLD; // In bounding radii; farther instances use their coarsest LOD
     static size_t FEW_LIGHTS_THRESHOLD;
-    static size_t LARGE_MESH_THRESHOLD;
+    static size_t LARGE_MESH_THRESHOLD; // Triangles from which a mesh gets generated LODs
     static float LOW_SCENE_COVERAGE_THRESHOLD; // Total scene screen coverage threshold
+    // Device costs fitted by CostModel::Calibrate; while valid, hybrid mode compares estimated
+    // forward and deferred costs instead of applying the thresholds above
+    static CostModel COST_MODEL;
 
-    // Heuristic function to determine if object should use forward rendering
-    static bool ShouldUseForward(const Material& material, size_t triangleCount, 
-                                 size_t numLights = 0,
-                                 float totalSceneCoverage = 0.0f,
-                                float totalOverdraw = 0.0f);
+    // One instance's share of the scene metrics (all zero outside the measuring frustum)
+    struct InstanceMetrics {
+        uint32_t fragments = 0;     // Samples that passed the depth test while the scene was drawn in order
+        uint32_t visiblePixels = 0; // Samples still visible once the whole scene's depth is in
+        uint32_t lights = 0;        // Lights whose radius reaches the instance's bounds
+    };
 
-    
     // Structure to hold scene metrics
     struct SceneMetrics {
         float overdrawRatio;    // Average overdraw (1.0 = no overdraw, 2.0 = 2x overdraw, etc.)
         float screenCoverage;   // Fraction of screen covered by visible geometry (0.0 to 1.0)
+        std::vector<InstanceMetrics> instances; // Indexed like the scene's instances
+        uint32_t forwardLights = 0; // Lights every forward fragment loops over; 0 = only those reaching it
     };
+
+    // Heuristic function to determine if object should use forward rendering, from its own
+    // overdraw and overlapping lights (the scene's overdraw when it was not measured),
+    // priced with COST_MODEL when it is valid
+    static bool ShouldUseForward(const Material& material, size_t triangleCount,
+                                 const InstanceMetrics& instance, const SceneMetrics& scene);
+
+    // Fill metrics.instances[i].lights from the light radii and instance bounds
+    void CountInstanceLights(SceneMetrics& metrics) const;
     
-    // Measure overdraw and screen coverage for the entire scene using stencil buffer
-    SceneMetrics MeasureOverdraw(Shader& shader, int viewportWidth, int viewportHeight,
-                                 const glm::mat4& view, const glm::mat4& projection) const;
-    
-    // Update rendering mode for all meshes based on heuristics
-    // Call this after scene is loaded or when camera/lighting changes
-    void UpdateRenderingMode(Shader& gbufferShader, int viewportWidth, int viewportHeight, Mode mode);
+    // Update rendering mode for all instances based on heuristics
+    // Call this after scene is loaded or when camera/lighting changes. In hybrid mode the
+    // overdraw is measured from the scene camera and waited for. forwardCullsLights:
+    // the forward pass only loops over the lights reaching each fragment (clustered)
+    void UpdateRenderingMode(OverdrawMetrics& overdraw, Shader& gbufferShader, int viewportWidth, int viewportHeight,
+                             Mode mode, bool forwardCullsLights = false);
+    // Reclassify every instance for hybrid mode from measured overdraw metrics (counts the
+    // lights); prints one forward/deferred summary line
+    void ApplyHybridMetrics(SceneMetrics& metrics, int viewportWidth, int viewportHeight, bool forwardCullsLights);
     
     Camera camera;
 
+    static const unsigned int IMPORT_FLAGS; // Assimp post-processing; part of the cache key
+    static int IMPORT_THREADS; // Mesh conversion workers; 0 = one per hardware thread
+    static bool OPTIMIZE_MESHES; // Run MeshOptimizer on import; part of the cache key
+    static bool GENERATE_LODS;   // Run MeshSimplifier on large meshes on import; part of the cache key
+    static bool LOG_CLASSIFICATION; // Print the reason for every hybrid instance sent forward
+    static float LOD_PIXEL_ERROR; // Screen-space error SelectLods accepts
+    static VertexFormat VERTEX_FORMAT; // GPU layout of uploaded meshes (not part of the cache key)
+
+    // Vertex + index buffer bytes of all meshes, and what VERTEX_FLOAT would take
+    size_t GetGeometryBytes() const;
+    size_t GetFloatLayoutGeometryBytes() const;
+
 private:
+    friend class SceneCache; // Serializes the flattened scene
+    friend class OverdrawMetrics; // Draws instances one by one under its queries
+
+    // Uniform handles resolved once per shader program
+    struct MeshUniforms {
+        Shader::Uniform<int> instanceBase;
+        Shader::Uniform<glm::vec3> positionOffset; // Per-mesh dequantization (Mesh::GetPositionOffset)
+        Shader::Uniform<glm::vec3> positionScale;
+        Shader::Uniform<glm::vec3> diffuse;
+        Shader::Uniform<glm::vec3> specular;
+        Shader::Uniform<float> shininess;
+        Shader::Uniform<float> opacity;
+        Shader::Uniform<int> materialIndex; // Material-ID G-buffer: replaces the four above
+
+        static MeshUniforms Resolve(const Shader& shader);
+        void SetMaterial(Shader& shader, const Material& material) const;
+    };
+    enum InstanceFilter { ALL_INSTANCES, DEFERRED_INSTANCES, FORWARD_INSTANCES };
+    // Upload the transforms of the filtered drawOrder instances and draw each run of
+    // one mesh with a single instanced call. Expects the shader to be in use
+    int DrawInstances(Shader& shader, const MeshUniforms& uniforms, const std::vector<uint32_t>& drawOrder,
+                      InstanceFilter filter, int* drawCalls, size_t* triangles) const;
+    // Draw every drawOrder instance on its own at full detail inside queries[k]
+    // (GL_SAMPLES_PASSED), from a single upload of their transforms. Expects the shader to be in use
+    void DrawInstancesQueried(Shader& shader, const MeshUniforms& uniforms, const std::vector<uint32_t>& drawOrder,
+                              const GLuint* queries) const;
+    // Assimp import of meshes, instances (with world bounds), materials and lights
+    bool Import(const std::string& fileName);
+    // meshLookup maps aiMesh index to meshes index (-1 until first referenced);
+    // uniqueMeshes lists the referenced aiMesh indices in meshes order
     void processNode(aiNode* node, const aiScene* scene , glm::mat4 parentTransformation,
-        std::unordered_map<std::string, glm::mat4>& nodeTransformations);
+        std::unordered_map<std::string, glm::mat4>& nodeTransformations, std::vector<int>& meshLookup,
+        std::vector<unsigned int>& uniqueMeshes);
     Material processMaterials(aiMaterial* material);
-    Mesh processMesh(aiMesh* mesh);
+    // Convert the unique meshes on a worker pool and upload them on this (GL) thread in order
+    void processMeshes(const aiScene* scene, const std::vector<unsigned int>& uniqueMeshes);
+    static MeshData processMesh(const aiMesh* mesh); // Thread-safe, no GL calls
+    static void GetWorldBounds(const Mesh& mesh, const glm::mat4& transformation, glm::vec3& outMin, glm::vec3& outMax);
+
+    // A run of consecutive draws of one mesh
+    struct InstanceRun {
+        uint32_t mesh;
+        int lod;
+        int first; // First matrix in the instance buffer
+        int count;
+    };
 
+    uint64_t id;
+    bool keepCpuGeometry;
+    bool loadedFromCache;
+    ImportStats importStats;
+    std::vector<MeshOptimizationStats> meshOptimizationStats;
     std::vector<Mesh> meshes;
+    std::vector<MeshInstance> instances;
     std::vector<Material> materials;
     std::vector<Light> lights;
+    LightBuffer lightBuffer; // GPU copy of lights, uploaded only when they change
+    MaterialBuffer materialBuffer; // GPU copy of materials, uploaded once on load
+    std::vector<glm::vec3> worldBoundsMin; // Per-instance world-space AABBs
+    std::vector<glm::vec3> worldBoundsMax;
+    MeshBVH bvh; // Built once at load over the world-space bounds
+    mutable std::vector<uint8_t> instanceLods; // Per-instance level of detail (SelectLods)
+    // Per-draw scratch, reused to avoid reallocating every frame
+    mutable InstanceBuffer instanceBuffer;
+    mutable std::vector<glm::mat4> instanceTransforms;
+    mutable std::vector<InstanceRun> instanceRuns;
 };
\ No newline at end of file
@@ -0,0 +1,298 @@
+#include "SceneCache.h"
+#include "Scene.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char CACHE_MAGIC[8] = {'S', 'C', 'N', 'C', 'A', 'C', 'H', 'E'};
+const size_t BLOB_ALIGNMENT = 16;
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t importFlags;
+    uint32_t meshesOptimized;  // Scene::OPTIMIZE_MESHES at write time
+    uint32_t lodsGenerated;    // Scene::GENERATE_LODS at write time
+    uint64_t sourceHash;
+    uint64_t sourceSize;
+    uint32_t meshCount, instanceCount, materialCount, lightCount;
+    uint32_t lodCount, padding;
+    uint64_t vertexBlobOffset, indexBlobOffset; // Byte offsets from the start of the file
+    uint64_t vertexTotal, indexTotal;           // Elements in each blob
+};
+
+struct CacheMesh {
+    uint32_t materialIndex;
+    uint32_t vertexCount, indexCount;
+    uint32_t lodIndexCount;           // Coarser levels, stored right after the mesh's indices
+    uint64_t firstVertex, firstIndex; // Offsets into the blobs, in elements
+    glm::vec3 bboxMin, bboxMax;
+    uint32_t firstLod, lodCount;      // Range in the MeshLod records
+};
+
+struct CacheInstance {
+    uint32_t mesh;
+    glm::mat4 transformation;
+    glm::vec3 boundsMin, boundsMax;
+};
+
+static_assert(std::is_trivially_copyable<Material>::value && std::is_trivially_copyable<Light>::value &&
+              std::is_trivially_copyable<Vertex>::value && std::is_trivially_copyable<MeshLod>::value,
+              "Cached structs are copied as raw bytes");
+static_assert(sizeof(Vertex) == 6 * sizeof(float), "Vertex must be tightly packed");
+
+// Read-only memory mapping of a whole file, unmapped on destruction
+class MappedFile{
+public:
+    explicit MappedFile(const std::string& fileName) : data(nullptr), size(0) {
+        int fd = open(fileName.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* mapping = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED) {
+                data = (const uint8_t*)mapping;
+                size = (size_t)info.st_size;
+            }
+        }
+        close(fd); // The mapping stays valid
+    }
+    ~MappedFile() {
+        if (data) munmap((void*)data, size);
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* data;
+    size_t size;
+};
+
+uint64_t HashBytes(const uint8_t* bytes, size_t size){
+    // 64-bit FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+size_t AlignUp(size_t offset){
+    return (offset + BLOB_ALIGNMENT - 1) / BLOB_ALIGNMENT * BLOB_ALIGNMENT;
+}
+
+}
+
+bool SceneCache::HashFile(const std::string& fileName, uint64_t& hash, uint64_t& size){
+    MappedFile source(fileName);
+    if (!source.data) return false;
+    hash = HashBytes(source.data, source.size);
+    size = source.size;
+    return true;
+}
+
+bool SceneCache::Load(const std::string& cachePath, const std::string& sourceFile, unsigned int importFlags, Scene& scene){
+    MappedFile cache(cachePath);
+    if (!cache.data || cache.size < sizeof(CacheHeader)) return false;
+
+    CacheHeader header;
+    std::memcpy(&header, cache.data, sizeof(header));
+    if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != VERSION ||
+        header.importFlags != importFlags || header.meshesOptimized != (Scene::OPTIMIZE_MESHES ? 1u : 0u) ||
+        header.lodsGenerated != (Scene::GENERATE_LODS ? 1u : 0u)) {
+        std::cerr << "Warning: scene cache " << cachePath << " is from another version or import setting, ignoring it\n";
+        return false;
+    }
+
+    uint64_t sourceHash = 0, sourceSize = 0;
+    if (!HashFile(sourceFile, sourceHash, sourceSize) || sourceHash != header.sourceHash || sourceSize != header.sourceSize) {
+        std::cerr << "Warning: scene cache " << cachePath << " is stale, importing " << sourceFile << " instead\n";
+        return false;
+    }
+
+    // Every section must lie inside the file before anything is read from it. Each blob is
+    // checked against the file size on its own first, so the sums below cannot wrap
+    size_t recordsEnd = sizeof(CacheHeader) + header.meshCount * sizeof(CacheMesh) +
+                        header.instanceCount * sizeof(CacheInstance) +
+                        header.materialCount * sizeof(Material) + header.lightCount * sizeof(Light) +
+                        header.lodCount * sizeof(MeshLod);
+    if (header.vertexTotal > cache.size / sizeof(Vertex) || header.indexTotal > cache.size / sizeof(uint32_t) ||
+        header.vertexBlobOffset > cache.size || header.indexBlobOffset > cache.size ||
+        recordsEnd > header.vertexBlobOffset ||
+        header.vertexBlobOffset + header.vertexTotal * sizeof(Vertex) > header.indexBlobOffset ||
+        header.indexBlobOffset + header.indexTotal * sizeof(uint32_t) > cache.size ||
+        header.vertexBlobOffset % alignof(Vertex) != 0 || header.indexBlobOffset % alignof(uint32_t) != 0) {
+        std::cerr << "Warning: scene cache " << cachePath << " is truncated or corrupt, ignoring it\n";
+        return false;
+    }
+
+    const uint8_t* cursor = cache.data + sizeof(CacheHeader);
+    std::vector<CacheMesh> meshRecords(header.meshCount);
+    std::memcpy(meshRecords.data(), cursor, meshRecords.size() * sizeof(CacheMesh));
+    cursor += meshRecords.size() * sizeof(CacheMesh);
+    std::vector<MeshLod> lodRecords(header.lodCount);
+    const uint8_t* lodCursor = cursor + header.instanceCount * sizeof(CacheInstance) +
+                               header.materialCount * sizeof(Material) + header.lightCount * sizeof(Light);
+    std::memcpy(lodRecords.data(), lodCursor, lodRecords.size() * sizeof(MeshLod));
+    for (const CacheMesh& record : meshRecords) {
+        bool lodsValid = (uint64_t)record.firstLod + record.lodCount <= header.lodCount;
+        for (uint32_t l = 0; lodsValid && l < record.lodCount; l++) {
+            const MeshLod& lod = lodRecords[record.firstLod + l];
+            lodsValid = (uint64_t)lod.firstIndex + lod.indexCount <= record.lodIndexCount;
+        }
+        if (record.firstVertex > header.vertexTotal || record.vertexCount > header.vertexTotal - record.firstVertex ||
+            record.firstIndex > header.indexTotal ||
+            (uint64_t)record.indexCount + record.lodIndexCount > header.indexTotal - record.firstIndex || !lodsValid ||
+            (record.materialIndex >= header.materialCount && header.materialCount > 0)) {
+            std::cerr << "Warning: scene cache " << cachePath << " has out-of-range mesh data, ignoring it\n";
+            return false;
+        }
+    }
+    for (size_t i = 0; i < header.instanceCount; i++) {
+        CacheInstance record;
+        std::memcpy(&record, cursor + i * sizeof(CacheInstance), sizeof(record));
+        if (record.mesh >= header.meshCount) {
+            std::cerr << "Warning: scene cache " << cachePath << " has out-of-range mesh data, ignoring it\n";
+            return false;
+        }
+    }
+
+    // Mesh data goes from the mapping straight into the GL buffers
+    const Vertex* vertexBlob = (const Vertex*)(cache.data + header.vertexBlobOffset);
+    const uint32_t* indexBlob = (const uint32_t*)(cache.data + header.indexBlobOffset);
+    scene.meshes.reserve(meshRecords.size());
+    for (const CacheMesh& record : meshRecords) {
+        MeshLods lods;
+        lods.indices = indexBlob + record.firstIndex + record.indexCount;
+        lods.indexCount = record.lodIndexCount;
+        lods.levels.assign(lodRecords.begin() + record.firstLod, lodRecords.begin() + record.firstLod + record.lodCount);
+        scene.meshes.emplace_back(vertexBlob + record.firstVertex, record.vertexCount,
+                                  indexBlob + record.firstIndex, record.indexCount,
+                                  record.materialIndex, scene.keepCpuGeometry, Scene::VERTEX_FORMAT, lods);
+        Mesh& mesh = scene.meshes.back();
+        mesh.bboxMin = record.bboxMin;
+        mesh.bboxMax = record.bboxMax;
+        mesh.center = (record.bboxMin + record.bboxMax) * 0.5f;
+    }
+
+    scene.instances.resize(header.instanceCount);
+    scene.worldBoundsMin.resize(header.instanceCount);
+    scene.worldBoundsMax.resize(header.instanceCount);
+    for (size_t i = 0; i < header.instanceCount; i++) {
+        CacheInstance record;
+        std::memcpy(&record, cursor, sizeof(record));
+        cursor += sizeof(record);
+        scene.instances[i].mesh = record.mesh;
+        scene.instances[i].transformation = record.transformation;
+        scene.worldBoundsMin[i] = record.boundsMin;
+        scene.worldBoundsMax[i] = record.boundsMax;
+    }
+
+    scene.materials.resize(header.materialCount);
+    std::memcpy(scene.materials.data(), cursor, header.materialCount * sizeof(Material));
+    cursor += header.materialCount * sizeof(Material);
+    scene.lights.resize(header.lightCount);
+    std::memcpy(scene.lights.data(), cursor, header.lightCount * sizeof(Light));
+
+    std::cout << "Loaded scene cache " << cachePath << " (" << header.meshCount << " meshes, "
+              << header.instanceCount << " instances)" << std::endl;
+    return true;
+}
+
+bool SceneCache::Write(const std::string& cachePath, const std::string& sourceFile, unsigned int importFlags, const Scene& scene){
+    CacheHeader header{};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = VERSION;
+    header.importFlags = importFlags;
+    header.meshesOptimized = Scene::OPTIMIZE_MESHES ? 1u : 0u;
+    header.lodsGenerated = Scene::GENERATE_LODS ? 1u : 0u;
+    if (!HashFile(sourceFile, header.sourceHash, header.sourceSize)) {
+        std::cerr << "Warning: cannot read " << sourceFile << " to hash it, scene cache not written\n";
+        return false;
+    }
+    header.meshCount = (uint32_t)scene.meshes.size();
+    header.instanceCount = (uint32_t)scene.instances.size();
+    header.materialCount = (uint32_t)scene.materials.size();
+    header.lightCount = (uint32_t)scene.lights.size();
+
+    std::vector<CacheMesh> meshRecords;
+    meshRecords.reserve(scene.meshes.size());
+    for (const Mesh& mesh : scene.meshes) {
+        CacheMesh record{};
+        record.materialIndex = (uint32_t)mesh.materialIndex;
+        record.vertexCount = (uint32_t)mesh.GetVertexCount();
+        record.indexCount = (uint32_t)mesh.GetIndexCount();
+        record.firstVertex = header.vertexTotal;
+        record.firstIndex = header.indexTotal;
+        record.bboxMin = mesh.bboxMin;
+        record.bboxMax = mesh.bboxMax;
+        record.firstLod = header.lodCount;
+        record.lodCount = (uint32_t)mesh.GetLods().size();
+        for (const MeshLod& lod : mesh.GetLods()) record.lodIndexCount += lod.indexCount;
+        header.vertexTotal += record.vertexCount;
+        header.indexTotal += record.indexCount + record.lodIndexCount;
+        header.lodCount += record.lodCount;
+        meshRecords.push_back(record);
+    }
+
+    size_t recordsEnd = sizeof(CacheHeader) + meshRecords.size() * sizeof(CacheMesh) +
+                        scene.instances.size() * sizeof(CacheInstance) +
+                        scene.materials.size() * sizeof(Material) + scene.lights.size() * sizeof(Light) +
+                        header.lodCount * sizeof(MeshLod);
+    header.vertexBlobOffset = AlignUp(recordsEnd);
+    header.indexBlobOffset = AlignUp(header.vertexBlobOffset + header.vertexTotal * sizeof(Vertex));
+
+    std::string tempPath = cachePath + ".tmp";
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Warning: cannot write scene cache " << tempPath << std::endl;
+        return false;
+    }
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)meshRecords.data(), (std::streamsize)(meshRecords.size() * sizeof(CacheMesh)));
+    for (size_t i = 0; i < scene.instances.size(); i++) {
+        CacheInstance record{};
+        record.mesh = scene.instances[i].mesh;
+        record.transformation = scene.instances[i].transformation;
+        record.boundsMin = scene.worldBoundsMin[i];
+        record.boundsMax = scene.worldBoundsMax[i];
+        out.write((const char*)&record, sizeof(record));
+    }
+    out.write((const char*)scene.materials.data(), (std::streamsize)(scene.materials.size() * sizeof(Material)));
+    out.write((const char*)scene.lights.data(), (std::streamsize)(scene.lights.size() * sizeof(Light)));
+    for (const Mesh& mesh : scene.meshes) {
+        out.write((const char*)mesh.GetLods().data(), (std::streamsize)(mesh.GetLods().size() * sizeof(MeshLod)));
+    }
+
+    // Geometry comes from the CPU copy if kept, otherwise it is read back from GL.
+    // Both blobs are filled mesh by mesh; seeking past the end zero-fills the alignment gaps
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices, lodIndices;
+    for (size_t i = 0; i < scene.meshes.size(); i++) {
+        scene.meshes[i].ReadGeometry(vertices, indices);
+        scene.meshes[i].ReadLodIndices(lodIndices);
+        indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+        out.seekp((std::streamoff)(header.vertexBlobOffset + meshRecords[i].firstVertex * sizeof(Vertex)));
+        out.write((const char*)vertices.data(), (std::streamsize)(vertices.size() * sizeof(Vertex)));
+        out.seekp((std::streamoff)(header.indexBlobOffset + meshRecords[i].firstIndex * sizeof(uint32_t)));
+        out.write((const char*)indices.data(), (std::streamsize)(indices.size() * sizeof(uint32_t)));
+    }
+
+    out.close();
+    if (!out || std::rename(tempPath.c_str(), cachePath.c_str()) != 0) {
+        std::cerr << "Warning: failed to write scene cache " << cachePath << std::endl;
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+class Scene;
+
+// Binary cache of a flattened, imported scene, written next to the source as
+// <file>.scenecache. A warm start maps the cache and uploads mesh data to GL
+// straight from the mapping, skipping Assimp and the process* functions.
+// Layout (all little-endian, tightly packed):
+//   Header
+//   Mesh records      material, counts, blob offsets, local bounds, LOD range
+//   Instance records  mesh index, world transform, world bounds
+//   Material[]        Light[] (raw structs, radius already computed)
+//   MeshLod[]         Generated levels of detail of every mesh
+//   Vertex blob       Index blob (16-byte aligned; each mesh's LOD indices follow its own)
+// The header stores the format version, the Assimp import flags, whether the
+// meshes went through MeshOptimizer and MeshSimplifier, and a 64-bit FNV-1a hash
+// and size of the source file; any mismatch is a miss and the scene is imported normally.
+class SceneCache{
+public:
+    static const uint32_t VERSION = 3;
+
+    static std::string PathFor(const std::string& sourceFile) { return sourceFile + ".scenecache"; }
+
+    // Fill an empty scene from a matching cache; false (scene untouched) on a miss or bad file
+    static bool Load(const std::string& cachePath, const std::string& sourceFile, unsigned int importFlags, Scene& scene);
+
+    // Serialize an imported scene; written to a temporary file and renamed into place
+    static bool Write(const std::string& cachePath, const std::string& sourceFile, unsigned int importFlags, const Scene& scene);
+
+private:
+    // Hash and size of the source file; false if it cannot be read
+    static bool HashFile(const std::string& fileName, uint64_t& hash, uint64_t& size);
+};
@@ -3,6 +3,10 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <GL/glew.h>
 #include <iostream>
+#include <cstring>
+#include <algorithm>
+
+Shader::UniformStats Shader::frameStats{};
 
 Shader::Shader(const std::string& vertexCode, const std::string& fragmentCode){
     int success{};
@@ -47,38 +51,142 @@ Shader::Shader(const std::string& vertexCode, const std::string& fragmentCode){
 
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
+
+    ReflectUniforms();
+}
+
+std::string Shader::WithDefines(const std::string& code, const std::vector<std::string>& defines){
+    std::string defineBlock;
+    for (const auto& define : defines){
+        defineBlock += "#define " + define + "\n";
+    }
+
+    // #version must stay the first directive
+    size_t versionPos = code.find("#version");
+    if (versionPos == std::string::npos)
+        return defineBlock + code;
+    size_t lineEnd = code.find('\n', versionPos);
+    if (lineEnd == std::string::npos)
+        return code + "\n" + defineBlock;
+    return code.substr(0, lineEnd + 1) + defineBlock + code.substr(lineEnd + 1);
+}
+
+void Shader::ReflectUniforms(){
+    GLint numUniforms = 0, maxNameLength = 0;
+    glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &numUniforms);
+    glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    std::vector<char> nameBuffer(std::max(maxNameLength, 1));
+    int maxLocation = -1;
+
+    for (GLint i = 0; i < numUniforms; i++){
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(programID, (GLuint)i, (GLsizei)nameBuffer.size(), nullptr, &size, &type, nameBuffer.data());
+        std::string name(nameBuffer.data());
+
+        GLint location = glGetUniformLocation(programID, name.c_str());
+        if (location < 0)
+            continue; // Uniform block member, not settable through glUniform*
+
+        uniformLocations[name] = location;
+        maxLocation = std::max(maxLocation, (int)location);
+
+        // Arrays of basic types are reported once as "name[0]": register the bare
+        // name and every element so lookups like "weights[3]" hit the table too
+        const std::string arraySuffix = "[0]";
+        if (name.size() > arraySuffix.size() &&
+            name.compare(name.size() - arraySuffix.size(), arraySuffix.size(), arraySuffix) == 0){
+            std::string baseName = name.substr(0, name.size() - arraySuffix.size());
+            uniformLocations[baseName] = location;
+            for (GLint element = 1; element < size; element++){
+                std::string elementName = baseName + "[" + std::to_string(element) + "]";
+                GLint elementLocation = glGetUniformLocation(programID, elementName.c_str());
+                if (elementLocation >= 0){
+                    uniformLocations[elementName] = elementLocation;
+                    maxLocation = std::max(maxLocation, (int)elementLocation);
+                }
+            }
+        }
+    }
+
+    cachedValues.assign(maxLocation + 1, CachedValue{});
+}
+
+int Shader::GetLocation(const std::string& name) const {
+    auto it = uniformLocations.find(name);
+    return it != uniformLocations.end() ? it->second : -1;
+}
+
+bool Shader::UpdateCachedValue(int location, const float* data, size_t count){
+    if (location < 0 || location >= (int)cachedValues.size())
+        return false;
+    frameStats.lookupsAvoided++;
+
+    CachedValue& cached = cachedValues[location];
+    size_t bytes = count * sizeof(float);
+    if (cached.valid && std::memcmp(cached.data.data(), data, bytes) == 0){
+        frameStats.redundantSkipped++;
+        return false;
+    }
+    std::memcpy(cached.data.data(), data, bytes);
+    cached.valid = true;
+    frameStats.uploads++;
+    return true;
+}
+
+Shader::~Shader(){
+    glDeleteProgram(programID);
 }
 
 void Shader::Use(){
     glUseProgram(programID);
 }
 
+void Shader::Set(Uniform<glm::vec3> uniform, glm::vec3 value){
+    const float data[3] = {value.x, value.y, value.z};
+    if (UpdateCachedValue(uniform.location, data, 3)) {
+        glUniform3f(uniform.location, value.x, value.y, value.z);
+    }
+}
+
+void Shader::Set(Uniform<glm::mat4> uniform, const glm::mat4& value){
+    if (UpdateCachedValue(uniform.location, glm::value_ptr(value), 16)) {
+        glUniformMatrix4fv(uniform.location, 1, GL_FALSE, glm::value_ptr(value));
+    }
+}
+
+void Shader::Set(Uniform<float> uniform, float value){
+    if (UpdateCachedValue(uniform.location, &value, 1)) {
+        glUniform1f(uniform.location, value);
+    }
+}
+
+void Shader::Set(Uniform<int> uniform, int value){
+    float bits;
+    std::memcpy(&bits, &value, sizeof(float));
+    if (UpdateCachedValue(uniform.location, &bits, 1)) {
+        glUniform1i(uniform.location, value);
+    }
+}
+
 void Shader::SetValue(const std::string& name, glm::vec3 value){
-    GLint location = glGetUniformLocation(programID, name.c_str());
-    if (location >= 0) {
-        glUniform3f(location, value.x, value.y, value.z);
+    Uniform<glm::vec3> uniform = GetUniform<glm::vec3>(name);
+    if (uniform.IsValid()) {
+        Set(uniform, value);
     } else {
         std::cerr << "Warning: Uniform '" << name << "' not found in shader\n";
     }
 }
 
 void Shader::SetValue(const std::string& name, glm::mat4 value){
-    GLint location = glGetUniformLocation(programID, name.c_str());
-    if (location >= 0) {
-        glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
-    }
+    Set(GetUniform<glm::mat4>(name), value);
 }
 
 void Shader::SetValue(const std::string& name, float value){
-    GLint location = glGetUniformLocation(programID, name.c_str());
-    if (location >= 0) {
-        glUniform1f(location, value);
-    }
+    Set(GetUniform<float>(name), value);
 }
 
 void Shader::SetValue(const std::string& name, int value){
-    GLint location = glGetUniformLocation(programID, name.c_str());
-    if (location >= 0) {
-        glUniform1i(location, value);
-    }
+    Set(GetUniform<int>(name), value);
 }
\ No newline at end of file
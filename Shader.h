@@ -1,13 +1,50 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <array>
+#include <unordered_map>
 #include <glm/glm.hpp>
 
 class Shader{
 public:
+    // Resolved uniform location, typed by the value it accepts.
+    // Resolve once with GetUniform<T>(name), then Set() as often as needed.
+    template<typename T>
+    struct Uniform {
+        int location = -1;
+        bool IsValid() const { return location >= 0; }
+    };
+
+    // Per-frame uniform traffic counters (shared by all shaders)
+    struct UniformStats {
+        size_t uploads = 0;            // glUniform* calls actually issued
+        size_t redundantSkipped = 0;   // Sets skipped because the value was already current
+        size_t lookupsAvoided = 0;     // glGetUniformLocation calls replaced by the link-time table
+    };
+    static UniformStats frameStats;
+    static void ResetFrameStats() { frameStats = UniformStats{}; }
+
     Shader(const std::string& vertexCode, const std::string& fragmentCode);
+    ~Shader();
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
     void Use();
 
+    // Insert "#define NAME" lines after the #version directive to build a shader variant
+    static std::string WithDefines(const std::string& code, const std::vector<std::string>& defines);
+
+    // Location lookup in the table reflected at link time (no driver call)
+    int GetLocation(const std::string& name) const;
+
+    template<typename T>
+    Uniform<T> GetUniform(const std::string& name) const { return Uniform<T>{GetLocation(name)}; }
+
+    void Set(Uniform<glm::vec3> uniform, glm::vec3 value);
+    void Set(Uniform<glm::mat4> uniform, const glm::mat4& value);
+    void Set(Uniform<float> uniform, float value);
+    void Set(Uniform<int> uniform, int value);
+
     void SetValue(const std::string& name, glm::vec3 value);
     void SetValue(const std::string& name, glm::mat4 value);
     void SetValue(const std::string& name, float value);
@@ -16,4 +53,16 @@ public:
     uint32_t programID;
 
 private:
-};
\ No newline at end of file
+    void ReflectUniforms();
+    // Returns true if the value differs from what was last uploaded to this location
+    bool UpdateCachedValue(int location, const float* data, size_t count);
+
+    std::unordered_map<std::string, int> uniformLocations;
+
+    // Last uploaded value per location, to drop redundant glUniform calls
+    struct CachedValue {
+        bool valid = false;
+        std::array<float, 16> data{};
+    };
+    std::vector<CachedValue> cachedValues;
+};
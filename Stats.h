@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+// Summary statistics over a set of frame-time samples (milliseconds)
+struct TimingSummary {
+    size_t count = 0;
+    float mean = 0.0f;
+    float median = 0.0f;
+    float stdDev = 0.0f;
+    float min = 0.0f;
+    float max = 0.0f;
+    float p95 = 0.0f;
+    float p99 = 0.0f;
+
+    // Nearest-rank percentile of an already sorted sample set, p in [0, 100]
+    static float Percentile(const std::vector<float>& sorted, float p) {
+        if (sorted.empty()) return 0.0f;
+        size_t rank = (size_t)std::ceil(p / 100.0f * sorted.size());
+        rank = std::min(std::max(rank, (size_t)1), sorted.size());
+        return sorted[rank - 1];
+    }
+
+    static TimingSummary Compute(std::vector<float> samples) {
+        TimingSummary s;
+        if (samples.empty()) return s;
+
+        std::sort(samples.begin(), samples.end());
+        s.count = samples.size();
+
+        // Mean
+        float sum = 0.0f;
+        for (float time : samples) {
+            sum += time;
+        }
+        s.mean = sum / samples.size();
+
+        // Median
+        s.median = samples.size() % 2 == 0
+            ? (samples[samples.size() / 2 - 1] + samples[samples.size() / 2]) / 2.0f
+            : samples[samples.size() / 2];
+
+        // Min/Max
+        s.min = samples.front();
+        s.max = samples.back();
+
+        // Standard deviation
+        float variance = 0.0f;
+        for (float time : samples) {
+            float diff = time - s.mean;
+            variance += diff * diff;
+        }
+        s.stdDev = std::sqrt(variance / samples.size());
+
+        s.p95 = Percentile(samples, 95.0f);
+        s.p99 = Percentile(samples, 99.0f);
+        return s;
+    }
+};
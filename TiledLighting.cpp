@@ -0,0 +1,177 @@
+#include "TiledLighting.h"
+#include "Scene.h"
+#include "Renderer.h"
+#include "LightCulling.h"
+
+#include <algorithm>
+#include <cmath>
+
+TiledLighting::TiledLighting(int width, int height, GBufferLayout gbufferLayout)
+    : width(width), height(height),
+      tilesX((width + TILE_SIZE - 1) / TILE_SIZE), tilesY((height + TILE_SIZE - 1) / TILE_SIZE),
+      depthShader(ReadTextFile("lighting_vert.glsl"), GBuffer::WithLayout(ReadTextFile("tile_depth_frag.glsl"), gbufferLayout)),
+      depthFBO(), depthTexture(), depthPBO(), depthPending(false),
+      gridBuffer(), gridTexture(), indexBuffer(), indexTexture()
+{
+    // Tile depth bounds target (one texel per tile)
+    glGenFramebuffers(1, &depthFBO);
+    glGenTextures(1, &depthTexture);
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, tilesX, tilesY, 0, GL_RG, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, depthFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, depthTexture, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Tile depth FBO incomplete!\n";
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // Pixel pack buffer the tile depth is read into, mapped a frame later
+    glGenBuffers(1, &depthPBO);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, depthPBO);
+    glBufferData(GL_PIXEL_PACK_BUFFER, tilesX * tilesY * sizeof(glm::vec2), nullptr, GL_STREAM_READ);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    // Light grid and index lists (texture buffers, refilled every frame)
+    glGenBuffers(1, &gridBuffer);
+    glGenTextures(1, &gridTexture);
+    glBindBuffer(GL_TEXTURE_BUFFER, gridBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, tilesX * tilesY * 2 * sizeof(uint32_t), nullptr, GL_STREAM_DRAW);
+    glBindTexture(GL_TEXTURE_BUFFER, gridTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, gridBuffer);
+
+    glGenBuffers(1, &indexBuffer);
+    glGenTextures(1, &indexTexture);
+    glBindBuffer(GL_TEXTURE_BUFFER, indexBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(uint32_t), nullptr, GL_STREAM_DRAW);
+    glBindTexture(GL_TEXTURE_BUFFER, indexTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, indexBuffer);
+
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    // Until the first readback arrives every tile spans all depths, so only the screen rects cull
+    tileDepth.assign(tilesX * tilesY, glm::vec2(-1e30f, 1e30f));
+    tileGrid.resize(tilesX * tilesY * 2);
+}
+
+TiledLighting::~TiledLighting(){
+    glDeleteFramebuffers(1, &depthFBO);
+    glDeleteTextures(1, &depthTexture);
+    glDeleteBuffers(1, &depthPBO);
+    glDeleteTextures(1, &gridTexture);
+    glDeleteBuffers(1, &gridBuffer);
+    glDeleteTextures(1, &indexTexture);
+    glDeleteBuffers(1, &indexBuffer);
+}
+
+void TiledLighting::Build(const Scene& scene, GBuffer& gbuffer, const Quad& quad,
+                          const glm::mat4& view, const glm::mat4& projection){
+    ReduceTileDepth(gbuffer, quad, view, projection);
+    BinLights(scene, view, projection);
+
+    // Orphan and refill both buffers
+    glBindBuffer(GL_TEXTURE_BUFFER, gridBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, tileGrid.size() * sizeof(uint32_t), tileGrid.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, indexBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, std::max(lightIndices.size(), (size_t)1) * sizeof(uint32_t),
+                 lightIndices.empty() ? nullptr : lightIndices.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void TiledLighting::ReduceTileDepth(GBuffer& gbuffer, const Quad& quad, const glm::mat4& view, const glm::mat4& projection){
+    glBindFramebuffer(GL_FRAMEBUFFER, depthFBO);
+    glViewport(0, 0, tilesX, tilesY);
+
+    depthShader.Use();
+    glActiveTexture(GL_TEXTURE0);
+    if (gbuffer.layout != GBUFFER_FULL) {
+        glBindTexture(GL_TEXTURE_2D, gbuffer.depthTexture);
+        depthShader.SetValue("gDepth", 0);
+        depthShader.SetValue("inverseProjection", glm::inverse(projection));
+    } else {
+        glBindTexture(GL_TEXTURE_2D, gbuffer.textures[GBuffer::GBUFFER_TEXTURE_POSITION]);
+        depthShader.SetValue("gPosition", 0);
+        depthShader.SetValue("view", view);
+    }
+    depthShader.SetValue("tileSize", TILE_SIZE);
+    quad.Draw();
+
+    // Take the previous frame's bounds, which the GPU has had a frame to finish, then start
+    // this frame's readback into the same buffer
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, depthPBO);
+    if (depthPending) {
+        const void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, tileDepth.size() * sizeof(glm::vec2), GL_MAP_READ_BIT);
+        if (data) {
+            std::copy_n((const glm::vec2*)data, tileDepth.size(), tileDepth.begin());
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+    }
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glReadPixels(0, 0, tilesX, tilesY, GL_RG, GL_FLOAT, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    depthPending = true;
+}
+
+void TiledLighting::BinLights(const Scene& scene, const glm::mat4& view, const glm::mat4& projection){
+    const std::vector<Light>& lights = scene.GetLights();
+
+    // Tile rect and view depth range of every light
+    std::vector<TileRect> rects(lights.size());
+    std::vector<glm::vec2> depthRanges(lights.size());
+    std::vector<uint32_t> counts(tilesX * tilesY, 0);
+
+    auto overlapsTile = [&](size_t light, int tile){
+        const glm::vec2& tileRange = tileDepth[tile];
+        return depthRanges[light].x <= tileRange.y && depthRanges[light].y >= tileRange.x;
+    };
+
+    for (size_t i = 0; i < lights.size(); i++){
+        glm::vec3 center = glm::vec3(view * glm::vec4(lights[i].position, 1.0f));
+        float r = lights[i].radius;
+        rects[i] = ProjectSphereToTiles(center, r, projection, Camera::NearPlane, width, height, TILE_SIZE);
+        depthRanges[i] = glm::vec2(-center.z - r, -center.z + r);
+
+        const TileRect& rect = rects[i];
+        for (int y = rect.y0; y <= rect.y1; y++){
+            for (int x = rect.x0; x <= rect.x1; x++){
+                if (overlapsTile(i, y * tilesX + x))
+                    counts[y * tilesX + x]++;
+            }
+        }
+    }
+
+    // Prefix sum into (offset, count) pairs, then scatter the light indices
+    uint32_t total = 0;
+    for (int t = 0; t < tilesX * tilesY; t++){
+        tileGrid[t * 2] = total;
+        tileGrid[t * 2 + 1] = 0;
+        total += counts[t];
+    }
+    lightIndices.resize(total);
+
+    for (size_t i = 0; i < lights.size(); i++){
+        const TileRect& rect = rects[i];
+        for (int y = rect.y0; y <= rect.y1; y++){
+            for (int x = rect.x0; x <= rect.x1; x++){
+                int t = y * tilesX + x;
+                if (overlapsTile(i, t))
+                    lightIndices[tileGrid[t * 2] + tileGrid[t * 2 + 1]++] = (uint32_t)i;
+            }
+        }
+    }
+}
+
+void TiledLighting::Bind(Shader& lightingShader) const {
+    glActiveTexture(GL_TEXTURE0 + GRID_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, gridTexture);
+    glActiveTexture(GL_TEXTURE0 + INDEX_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, indexTexture);
+
+    lightingShader.SetValue("tileGrid", GRID_TEXTURE_UNIT);
+    lightingShader.SetValue("tileLightIndices", INDEX_TEXTURE_UNIT);
+    lightingShader.SetValue("tileSize", TILE_SIZE);
+    lightingShader.SetValue("tilesX", tilesX);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Shader.h"
+#include "GBuffer.h"
+#include "Quad.h"
+
+#include <vector>
+#include <glm/glm.hpp>
+#include <GL/glew.h>
+
+class Scene;
+
+// Tiled deferred lighting (GL 3.3, no compute):
+//   1. A reduction pass writes min/max view depth of each 16x16 screen tile
+//      from the G-buffer positions (or depth, in the compact layout) into a small
+//      RG32F target, read back to the CPU through a pixel pack buffer.
+//   2. Each light's sphere is projected to a screen rect and tested against the
+//      depth range of every tile it covers; survivors are appended to that tile's list.
+//      The depth ranges are the previous Build's, mapped once the GPU has had a frame to
+//      write them, so binning never waits on the reduction. The cost is a frame of lag:
+//      a light can miss a tile for one frame after the tile's depth moved into its range
+//      (the lighting pass still tests each light's radius per pixel).
+//   3. The per-tile (offset, count) grid and concatenated light indices are uploaded
+//      as texture buffers, and the lighting shader (TILED_LIGHTING) loops only over
+//      its tile's lights.
+class TiledLighting{
+public:
+    static const int TILE_SIZE = 16;
+    static const int GRID_TEXTURE_UNIT = 6;  // After LightBuffer::TEXTURE_UNIT
+    static const int INDEX_TEXTURE_UNIT = 7;
+
+    TiledLighting(int width, int height, GBufferLayout gbufferLayout = GBUFFER_FULL);
+    ~TiledLighting();
+    TiledLighting(const TiledLighting&) = delete;
+    TiledLighting& operator=(const TiledLighting&) = delete;
+
+    // Rebuild the per-tile light lists for this frame's G-buffer. Changes the bound
+    // framebuffer and viewport; expects depth testing to be disabled.
+    void Build(const Scene& scene, GBuffer& gbuffer, const Quad& quad,
+               const glm::mat4& view, const glm::mat4& projection);
+
+    // Bind the tile textures and set the tile uniforms on the tiled lighting shader
+    void Bind(Shader& lightingShader) const;
+
+    size_t GetLightIndexCount() const { return lightIndices.size(); } // Sum of all tile list lengths
+    int GetTileCount() const { return tilesX * tilesY; }
+
+private:
+    void ReduceTileDepth(GBuffer& gbuffer, const Quad& quad, const glm::mat4& view, const glm::mat4& projection);
+    void BinLights(const Scene& scene, const glm::mat4& view, const glm::mat4& projection);
+
+    int width, height;
+    int tilesX, tilesY;
+
+    Shader depthShader;
+    GLuint depthFBO, depthTexture;
+    GLuint depthPBO;     // Tile depth readback, one frame behind
+    bool depthPending;   // depthPBO holds a readback not yet copied to tileDepth
+
+    GLuint gridBuffer, gridTexture;
+    GLuint indexBuffer, indexTexture;
+
+    std::vector<glm::vec2> tileDepth;      // (min, max) view depth per tile, as of last frame
+    std::vector<uint32_t> tileGrid;        // (offset, count) per tile
+    std::vector<uint32_t> lightIndices;    // Concatenated per-tile light lists
+};
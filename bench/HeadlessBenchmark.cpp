@@ -0,0 +1,980 @@
+// Headless benchmark runner.
+//
+// Creates an offscreen OpenGL 3.3 core context through EGL (surfaceless platform,
+// e.g. Mesa llvmpipe on machines without a display), replays a camera path through
+// the same Renderer used by the interactive window, and writes per-frame and
+// summary timings as CSV and JSON.
+//
+// Usage (run from the repository root so the .glsl files resolve):
+//   HeadlessBenchmark <scene.fbx> [--path file.path] [--modes d,f,h]
+//                     [--width 800] [--height 800] [--warmup 10]
+//                     [--frames 100] [--steps 30] [--out bench_results] [--dump]
+//                     [--lighting fullscreen,tiled,volumes] [--forward all,clustered]
+//                     [--lights 1,64,1000,10000] [--light-radius R] [--occlusion off,on]
+//                     [--geometry mesh,merged] [--cache off|use|rebuild] [--build-cache]
+//                     [--import-threads 1,2,4,8] [--import-repeats 3] [--vertices float|compressed]
+//                     [--mesh-optimization on|off] [--lod on,off] [--lod-generation on|off]
+//                     [--gbuffer full|compact|material-id] [--depth-sharing on,off]
+//                     [--cost-profile file] [--calibrate] [--adaptive off,on]
+//                     [--overdraw-scale 0.5] [--overdraw-refresh N]
+//
+// Every combination of light count, lighting path, forward path, occlusion culling,
+// geometry backend, LOD selection, depth sharing, adaptive switching and mode is run. --lights replaces
+// the scene's lights with N synthetic point lights scattered over the scene bounds,
+// each with radius R (default: 15% of the bounds diagonal).
+// --dump additionally writes the last frame of each run to <out>_<mode>_<lighting>_<forward>_<lights>.ppm
+// (suffixed with _occlusion when occlusion culling is on, _merged for the merged geometry
+// backend, _nolod when LOD selection is off, _nodepthshare when depth sharing is off and
+// _adaptive when adaptive switching is on).
+//
+// --cache selects how <scene>.scenecache is used (default: use it when it matches the
+// source file); --build-cache imports the scene, (re)writes its cache and exits.
+// --import-threads only benchmarks scene import: the scene is loaded without the cache
+// --import-repeats times per mesh-conversion worker count, and the mean time of each
+// import stage is written to <out>_import.csv.
+// --vertices compressed uploads meshes with 16-bit quantized positions, 10:10:10:2 normals
+// and 16-bit indices where they fit (Mesh.h); the JSON reports the vertex + index buffer
+// size next to what the float layout would take.
+// Meshes are welded and reordered for the vertex cache, overdraw and vertex fetch on
+// import (MeshOptimizer.h) unless --mesh-optimization off; each import writes the
+// per-mesh ACMR before/after to <out>_meshopt.csv.
+// Meshes of at least Scene::LARGE_MESH_THRESHOLD triangles get simplified levels of
+// detail on import (MeshSimplifier.h) unless --lod-generation off; --lod off draws every
+// instance at full detail. The CSV and JSON report the triangles submitted per frame.
+// --gbuffer compact renders with the 16 byte/pixel G-buffer (GBuffer.h): positions come
+// from the depth texture, normals are octahedral RG16 and materials RGBA8. --gbuffer
+// material-id stores a 16-bit material index instead (10 bytes/pixel), looked up in the
+// scene's material table (MaterialBuffer.h) by the lighting passes.
+// The forward pass reuses the G-buffer depth (Renderer::shareDepth) unless --depth-sharing
+// off; the CSV and JSON report the fragments that passed its depth test, counted with a
+// samples-passed query read back after each frame is timed.
+// --cost-profile loads the device cost model (CostModel.h) hybrid mode classifies with,
+// measuring and writing it first if the file is missing or from another device/layout;
+// --calibrate always re-measures it (into cost_profile.txt unless --cost-profile is given).
+// Without either, hybrid mode uses the Scene thresholds. The JSON reports the model used.
+// --adaptive on lets hybrid runs re-trial their split from timer-query pass times
+// (AdaptiveHybrid.h) from the first warm-up frame on; every kept or reverted move is
+// written to <out>_adaptive.csv.
+// Each pass is also timed on the GPU (GpuProfiler.h): the CSV has the G-buffer, lighting
+// and forward GL_TIME_ELAPSED times of every frame, and the JSON their percentiles plus the
+// GPU time of the overdraw measurement in Prepare.
+// Hybrid mode measures overdraw at --overdraw-scale times the output resolution
+// (OverdrawMetrics.h; 1 = full resolution). --overdraw-refresh N re-measures it from the
+// current camera every N frames inside the timed frames and reclassifies once the results
+// arrive, without waiting for them (not with --adaptive on, which would lose its kept moves).
+//
+// Camera path format: one keyframe per line, "x y z yaw pitch [fov]", '#' starts a
+// comment. --steps frames are interpolated between consecutive keyframes. Without
+// --path the scene camera is held for --frames frames.
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/glew.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+#include "../Camera.h"
+#include "../Scene.h"
+#include "../Renderer.h"
+#include "../Stats.h"
+
+struct CameraKey {
+    glm::vec3 position;
+    float yaw, pitch, fov;
+};
+
+struct FrameSample {
+    size_t frame;
+    float ms;
+    int deferredCount;
+    int forwardCount;
+    int visibleMeshes;
+    int culledMeshes;
+    int occludedMeshes;
+    size_t materialChanges;
+    int drawCalls;
+    size_t triangles;
+    size_t forwardFragments;
+    glm::vec3 position;
+    Shader::UniformStats uniforms;
+    size_t tileLightIndices;
+    size_t clusterLightIndices;
+    GpuProfiler::FrameTimes gpu; // Pass times of this frame (all 0 if not read back)
+};
+
+struct ModeRun {
+    Mode mode;
+    LightingPath lighting;
+    ForwardLighting forward;
+    bool occlusion;
+    bool merged;
+    bool lod;
+    bool shareDepth;
+    bool adaptive;
+    size_t lightCount;
+    float preprocessMs;
+    float overdrawGpuMs; // GPU time of the overdraw measurement in Prepare
+    size_t gpuSamplesRejected; // Pass timings the profiler's sanity check dropped
+    std::vector<AdaptiveHybrid::Decision> decisions;
+    std::vector<FrameSample> frames;
+    TimingSummary summary;
+};
+
+static const char* ModeName(Mode mode){
+    switch (mode){
+        case DEFERRED: return "deferred";
+        case FORWARD:  return "forward";
+        case HYBRID:   return "hybrid";
+    }
+    return "unknown";
+}
+
+static const char* LightingName(LightingPath lighting){
+    switch (lighting){
+        case LIGHTING_FULLSCREEN: return "fullscreen";
+        case LIGHTING_TILED:      return "tiled";
+        case LIGHTING_VOLUMES:    return "volumes";
+    }
+    return "unknown";
+}
+
+static bool ParseLighting(const std::string& arg, std::vector<LightingPath>& paths){
+    std::stringstream ss(arg);
+    std::string item;
+    while (std::getline(ss, item, ',')){
+        if (item == "fullscreen") paths.push_back(LIGHTING_FULLSCREEN);
+        else if (item == "t" || item == "tiled") paths.push_back(LIGHTING_TILED);
+        else if (item == "v" || item == "volumes") paths.push_back(LIGHTING_VOLUMES);
+        else return false;
+    }
+    return !paths.empty();
+}
+
+static const char* ForwardName(ForwardLighting forward){
+    switch (forward){
+        case FORWARD_ALL_LIGHTS: return "all";
+        case FORWARD_CLUSTERED:  return "clustered";
+    }
+    return "unknown";
+}
+
+static bool ParseForward(const std::string& arg, std::vector<ForwardLighting>& paths){
+    std::stringstream ss(arg);
+    std::string item;
+    while (std::getline(ss, item, ',')){
+        if (item == "all") paths.push_back(FORWARD_ALL_LIGHTS);
+        else if (item == "c" || item == "clustered") paths.push_back(FORWARD_CLUSTERED);
+        else return false;
+    }
+    return !paths.empty();
+}
+
+static bool ParseOcclusion(const std::string& arg, std::vector<bool>& settings){
+    std::stringstream ss(arg);
+    std::string item;
+    while (std::getline(ss, item, ',')){
+        if (item == "off") settings.push_back(false);
+        else if (item == "on") settings.push_back(true);
+        else return false;
+    }
+    return !settings.empty();
+}
+
+static bool ParseLod(const std::string& arg, std::vector<bool>& settings){
+    return ParseOcclusion(arg, settings); // Same on/off list
+}
+
+static bool ParseGeometry(const std::string& arg, std::vector<bool>& settings){
+    std::stringstream ss(arg);
+    std::string item;
+    while (std::getline(ss, item, ',')){
+        if (item == "mesh") settings.push_back(false);
+        else if (item == "merged") settings.push_back(true);
+        else return false;
+    }
+    return !settings.empty();
+}
+
+static bool ParseCounts(const std::string& arg, std::vector<size_t>& counts){
+    std::stringstream ss(arg);
+    std::string item;
+    while (std::getline(ss, item, ',')){
+        try { counts.push_back(std::stoul(item)); }
+        catch (...) { return false; }
+    }
+    return !counts.empty();
+}
+
+// Deterministic pseudo-random point lights spread over the scene bounds
+static std::vector<Light> MakeSyntheticLights(size_t count, const glm::vec3& boundsMin,
+                                              const glm::vec3& boundsMax, float radius){
+    std::vector<Light> lights;
+    lights.reserve(count);
+
+    uint32_t state = 0x9E3779B9u;
+    auto next = [&state](){
+        state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+        return (state & 0xFFFFFF) / (float)0x1000000;
+    };
+
+    for (size_t i = 0; i < count; i++){
+        Light light{};
+        light.position = glm::vec3(
+            boundsMin.x + (boundsMax.x - boundsMin.x) * next(),
+            boundsMin.y + (boundsMax.y - boundsMin.y) * next(),
+            boundsMin.z + (boundsMax.z - boundsMin.z) * next());
+        light.color = glm::vec3(0.5f + 0.5f * next(), 0.5f + 0.5f * next(), 0.5f + 0.5f * next());
+
+        // Pure quadratic falloff chosen so Scene::ComputeLightRadius returns `radius`
+        float lightMax = std::max({light.color.r, light.color.g, light.color.b});
+        light.constant = 1.0f;
+        light.linear = 0.0f;
+        light.quadratic = ((256.0f / 5.0f) * lightMax - 1.0f) / (radius * radius);
+        light.radius = Scene::ComputeLightRadius(light);
+        lights.push_back(light);
+    }
+    return lights;
+}
+
+static bool ParseModes(const std::string& arg, std::vector<Mode>& modes){
+    std::stringstream ss(arg);
+    std::string item;
+    while (std::getline(ss, item, ',')){
+        if (item == "d" || item == "deferred") modes.push_back(DEFERRED);
+        else if (item == "f" || item == "forward") modes.push_back(FORWARD);
+        else if (item == "h" || item == "hybrid") modes.push_back(HYBRID);
+        else return false;
+    }
+    return !modes.empty();
+}
+
+static std::vector<CameraKey> LoadCameraPath(const std::string& fileName){
+    std::vector<CameraKey> keys;
+    std::ifstream file(fileName);
+    if (!file){
+        std::cerr << "Failed to open camera path " << fileName << std::endl;
+        return keys;
+    }
+
+    std::string line;
+    while (std::getline(file, line)){
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+
+        std::stringstream ss(line);
+        CameraKey key{};
+        key.fov = 60.0f;
+        if (ss >> key.position.x >> key.position.y >> key.position.z >> key.yaw >> key.pitch){
+            ss >> key.fov; // Optional
+            keys.push_back(key);
+        }
+    }
+    return keys;
+}
+
+// Expand keyframes into one camera per rendered frame
+static std::vector<Camera> ExpandCameraPath(const std::vector<CameraKey>& keys, int steps){
+    std::vector<Camera> cameras;
+    for (size_t k = 0; k + 1 < keys.size(); k++){
+        const CameraKey& a = keys[k];
+        const CameraKey& b = keys[k + 1];
+        for (int s = 0; s < steps; s++){
+            float t = (float)s / (float)steps;
+            cameras.emplace_back(a.position + (b.position - a.position) * t,
+                                 a.yaw + (b.yaw - a.yaw) * t,
+                                 a.pitch + (b.pitch - a.pitch) * t,
+                                 a.fov + (b.fov - a.fov) * t);
+        }
+    }
+    if (!keys.empty()){
+        const CameraKey& last = keys.back();
+        cameras.emplace_back(last.position, last.yaw, last.pitch, last.fov);
+    }
+    for (auto& camera : cameras){
+        camera.UpdateDirectionVectors();
+    }
+    return cameras;
+}
+
+// ============================================
+// EGL SURFACELESS CONTEXT
+// ============================================
+static bool CreateHeadlessContext(EGLDisplay& display, EGLContext& context){
+    display = EGL_NO_DISPLAY;
+
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay){
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (display == EGL_NO_DISPLAY){
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)){
+        std::cerr << "Failed to initialize EGL display\n";
+        return false;
+    }
+
+    if (!eglBindAPI(EGL_OPENGL_API)){
+        std::cerr << "EGL does not support desktop OpenGL\n";
+        return false;
+    }
+
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config = nullptr;
+    EGLint numConfigs = 0;
+    eglChooseConfig(display, configAttribs, &config, 1, &numConfigs);
+
+    // Request OpenGL 3.3 Core Profile (same as the windowed renderer)
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    context = eglCreateContext(display, numConfigs > 0 ? config : EGL_NO_CONFIG_KHR,
+                               EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT){
+        std::cerr << "Failed to create OpenGL 3.3 core context\n";
+        return false;
+    }
+
+    // No surface at all: everything renders into our own FBO
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)){
+        std::cerr << "Failed to make surfaceless context current\n";
+        return false;
+    }
+    return true;
+}
+
+// Releases the context when main returns. Declared before the scene and renderer, so their
+// destructors still run with the context current and actually free their GL objects
+struct HeadlessContextGuard {
+    EGLDisplay display;
+    EGLContext context;
+    ~HeadlessContextGuard(){
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(display, context);
+        eglTerminate(display);
+    }
+};
+
+// ============================================
+// OUTPUT
+// ============================================
+static void WriteCSV(const std::string& fileName, const std::vector<ModeRun>& runs){
+    std::ofstream out(fileName);
+    out << "mode,lighting,forward_lighting,occlusion,geometry,lod,depth_sharing,adaptive,lights,frame,ms,deferred,forward,visible,culled,occluded,material_changes,draw_calls,triangles,forward_fragments,cam_x,cam_y,cam_z,"
+        << "uniform_uploads,uniform_skipped,uniform_lookups_avoided,tile_light_indices,cluster_light_indices,"
+        << "gbuffer_gpu_ms,lighting_gpu_ms,forward_gpu_ms\n";
+    for (const auto& run : runs){
+        for (const auto& f : run.frames){
+            out << ModeName(run.mode) << "," << LightingName(run.lighting) << "," << ForwardName(run.forward) << ","
+                << (run.occlusion ? "on" : "off") << "," << (run.merged ? "merged" : "mesh") << ","
+                << (run.lod ? "on" : "off") << "," << (run.shareDepth ? "on" : "off") << ","
+                << (run.adaptive ? "on" : "off") << "," << run.lightCount << ","
+                << f.frame << "," << f.ms << ","
+                << f.deferredCount << "," << f.forwardCount << ","
+                << f.visibleMeshes << "," << f.culledMeshes << "," << f.occludedMeshes << ","
+                << f.materialChanges << "," << f.drawCalls << "," << f.triangles << "," << f.forwardFragments << ","
+                << f.position.x << "," << f.position.y << "," << f.position.z << ","
+                << f.uniforms.uploads << "," << f.uniforms.redundantSkipped << ","
+                << f.uniforms.lookupsAvoided << "," << f.tileLightIndices << ","
+                << f.clusterLightIndices << "," << f.gpu.ms[GPU_PASS_GBUFFER] << ","
+                << f.gpu.ms[GPU_PASS_LIGHTING] << "," << f.gpu.ms[GPU_PASS_FORWARD] << "\n";
+        }
+    }
+}
+
+static void WriteAdaptiveCSV(const std::string& fileName, const std::vector<ModeRun>& runs){
+    std::ofstream out(fileName);
+    out << "mode,lighting,forward_lighting,lights,frame,material,to,instances,baseline_ms,trial_ms,kept\n";
+    for (const auto& run : runs){
+        for (const auto& d : run.decisions){
+            out << ModeName(run.mode) << "," << LightingName(run.lighting) << "," << ForwardName(run.forward) << ","
+                << run.lightCount << "," << d.frame << "," << d.material << ","
+                << (d.toForward ? "forward" : "deferred") << "," << d.instances << ","
+                << d.baselineMs << "," << d.trialMs << "," << (d.kept ? "kept" : "reverted") << "\n";
+        }
+    }
+}
+
+static void WritePPM(const std::string& fileName, GLuint fbo, int width, int height){
+    std::vector<unsigned char> pixels((size_t)width * height * 3);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+    std::ofstream out(fileName, std::ios::binary);
+    out << "P6\n" << width << " " << height << "\n255\n";
+    // GL rows are bottom-up
+    for (int y = height - 1; y >= 0; y--){
+        out.write((const char*)&pixels[(size_t)y * width * 3], (std::streamsize)width * 3);
+    }
+}
+
+static void WriteJSON(const std::string& fileName, const std::string& sceneFile,
+                      size_t meshCount, size_t instanceCount, float loadMs, bool fromCache,
+                      size_t geometryBytes, size_t floatGeometryBytes, int width, int height,
+                      GBufferLayout gbufferLayout, float gbufferMemory,
+                      float overdrawScale, int overdrawRefreshFrames,
+                      const CostModel& costModel, const std::vector<ModeRun>& runs){
+    std::ofstream out(fileName);
+    out << "{\n";
+    out << "  \"scene\": \"" << sceneFile << "\",\n";
+    out << "  \"meshes\": " << meshCount << ",\n";
+    out << "  \"instances\": " << instanceCount << ",\n";
+    out << "  \"scene_load_ms\": " << loadMs << ",\n";
+    out << "  \"scene_cache\": " << (fromCache ? "true" : "false") << ",\n";
+    out << "  \"vertex_format\": \"" << (Scene::VERTEX_FORMAT == VERTEX_COMPRESSED ? "compressed" : "float") << "\",\n";
+    out << "  \"geometry_mb\": " << geometryBytes / (1024.0f * 1024.0f) << ",\n";
+    out << "  \"geometry_float_mb\": " << floatGeometryBytes / (1024.0f * 1024.0f) << ",\n";
+    out << "  \"width\": " << width << ",\n";
+    out << "  \"height\": " << height << ",\n";
+    out << "  \"gbuffer_layout\": \"" << (gbufferLayout == GBUFFER_COMPACT ? "compact" : gbufferLayout == GBUFFER_MATERIAL_ID ? "material-id" : "full") << "\",\n";
+    out << "  \"gbuffer_mb\": " << gbufferMemory << ",\n";
+    out << "  \"renderer\": \"" << (const char*)glGetString(GL_RENDERER) << "\",\n";
+    out << "  \"overdraw_scale\": " << overdrawScale << ",\n";
+    out << "  \"overdraw_refresh_frames\": " << overdrawRefreshFrames << ",\n";
+    if (costModel.valid) {
+        out << "  \"cost_model_ns\": {\"gbuffer_per_fragment\": " << costModel.gbufferPerFragment
+            << ", \"lighting_per_pixel\": " << costModel.lightingPerPixel
+            << ", \"lighting_per_pixel_light\": " << costModel.lightingPerPixelLight
+            << ", \"forward_per_fragment\": " << costModel.forwardPerFragment
+            << ", \"forward_per_fragment_light\": " << costModel.forwardPerFragmentLight << "},\n";
+    } else {
+        out << "  \"cost_model_ns\": null,\n";
+    }
+    out << "  \"modes\": [\n";
+    for (size_t r = 0; r < runs.size(); r++){
+        const ModeRun& run = runs[r];
+        const TimingSummary& s = run.summary;
+        out << "    {\n";
+        out << "      \"mode\": \"" << ModeName(run.mode) << "\",\n";
+        out << "      \"lighting\": \"" << LightingName(run.lighting) << "\",\n";
+        out << "      \"forward_lighting\": \"" << ForwardName(run.forward) << "\",\n";
+        out << "      \"occlusion\": " << (run.occlusion ? "true" : "false") << ",\n";
+        out << "      \"geometry\": \"" << (run.merged ? "merged" : "mesh") << "\",\n";
+        out << "      \"lod\": " << (run.lod ? "true" : "false") << ",\n";
+        out << "      \"depth_sharing\": " << (run.shareDepth ? "true" : "false") << ",\n";
+        out << "      \"adaptive\": " << (run.adaptive ? "true" : "false") << ",\n";
+        if (run.adaptive) {
+            size_t kept = 0;
+            for (const AdaptiveHybrid::Decision& decision : run.decisions) kept += decision.kept ? 1 : 0;
+            out << "      \"adaptive_trials\": " << run.decisions.size() << ",\n";
+            out << "      \"adaptive_moves_kept\": " << kept << ",\n";
+        }
+        out << "      \"lights\": " << run.lightCount << ",\n";
+        out << "      \"preprocess_ms\": " << run.preprocessMs << ",\n";
+        out << "      \"summary\": {\"frames\": " << s.count << ", \"mean\": " << s.mean
+            << ", \"median\": " << s.median << ", \"stddev\": " << s.stdDev
+            << ", \"min\": " << s.min << ", \"max\": " << s.max
+            << ", \"p95\": " << s.p95 << ", \"p99\": " << s.p99 << "},\n";
+        if (!run.frames.empty()){
+            const Shader::UniformStats& u = run.frames.back().uniforms;
+            out << "      \"uniforms_per_frame\": {\"uploads\": " << u.uploads
+                << ", \"redundant_skipped\": " << u.redundantSkipped
+                << ", \"lookups_avoided\": " << u.lookupsAvoided << "},\n";
+
+            float visible = 0.0f, culled = 0.0f, occluded = 0.0f;
+            double triangles = 0.0, forwardFragments = 0.0;
+            for (const auto& f : run.frames){
+                visible += f.visibleMeshes;
+                culled += f.culledMeshes;
+                occluded += f.occludedMeshes;
+                triangles += (double)f.triangles;
+                forwardFragments += (double)f.forwardFragments;
+            }
+            out << "      \"culling_per_frame\": {\"visible_mean\": " << visible / run.frames.size()
+                << ", \"culled_mean\": " << culled / run.frames.size()
+                << ", \"occluded_mean\": " << occluded / run.frames.size() << "},\n";
+            out << "      \"triangles_per_frame_mean\": " << triangles / run.frames.size() << ",\n";
+            out << "      \"forward_fragments_per_frame_mean\": " << forwardFragments / run.frames.size() << ",\n";
+
+            out << "      \"gpu_pass_ms\": {";
+            for (int pass = 0; pass < GPU_PASS_OVERDRAW; pass++){
+                std::vector<float> passTimes;
+                for (const auto& f : run.frames){
+                    if (f.gpu.measured[pass]) passTimes.push_back(f.gpu.ms[pass]);
+                }
+                TimingSummary p = TimingSummary::Compute(passTimes);
+                out << (pass ? ", " : "") << "\"" << GpuPassName((GpuPass)pass) << "\": {\"frames\": " << p.count
+                    << ", \"mean\": " << p.mean << ", \"median\": " << p.median
+                    << ", \"p95\": " << p.p95 << ", \"p99\": " << p.p99 << "}";
+            }
+            out << ", \"overdraw\": " << run.overdrawGpuMs << "},\n";
+            out << "      \"gpu_samples_rejected\": " << run.gpuSamplesRejected << ",\n";
+        }
+        out << "      \"frames_ms\": [";
+        for (size_t i = 0; i < run.frames.size(); i++){
+            out << (i ? ", " : "") << run.frames[i].ms;
+        }
+        out << "]\n";
+        out << "    }" << (r + 1 < runs.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+// Import benchmark: load the scene from scratch (cache off) repeats times for every
+// worker thread count and write the mean time of each load stage as CSV
+// Per-mesh ACMR before/after MeshOptimizer, plus a triangle-weighted summary on stdout
+static void WriteMeshOptimizationCSV(const std::string& fileName, const Scene& scene){
+    const std::vector<MeshOptimizationStats>& stats = scene.GetMeshOptimizationStats();
+    if (stats.empty()) return; // Cache hit or optimization off
+
+    std::ofstream out(fileName);
+    out << "mesh,triangles,vertices_before,vertices_after,acmr_before,acmr_after,clusters\n";
+    size_t triangles = 0, verticesBefore = 0, verticesAfter = 0;
+    double missesBefore = 0.0, missesAfter = 0.0;
+    for (size_t i = 0; i < stats.size(); i++){
+        const MeshOptimizationStats& s = stats[i];
+        out << i << "," << s.triangles << "," << s.verticesBefore << "," << s.verticesAfter << ","
+            << s.acmrBefore << "," << s.acmrAfter << "," << s.clusters << "\n";
+        triangles += s.triangles;
+        verticesBefore += s.verticesBefore;
+        verticesAfter += s.verticesAfter;
+        missesBefore += (double)s.acmrBefore * s.triangles;
+        missesAfter += (double)s.acmrAfter * s.triangles;
+    }
+    if (triangles > 0){
+        std::cout << "Mesh optimization: ACMR " << missesBefore / triangles << " -> " << missesAfter / triangles
+                  << " (cache " << VERTEX_CACHE_SIZE << "), vertices " << verticesBefore << " -> " << verticesAfter << std::endl;
+    }
+    std::cout << "Wrote " << fileName << std::endl;
+}
+
+static int RunImportBenchmark(const std::string& sceneFile, const std::vector<size_t>& threadCounts,
+                              int repeats, const std::string& fileName){
+    std::ofstream out(fileName);
+    out << "threads,read_ms,nodes_ms,meshes_ms,upload_ms,materials_ms,bounds_ms,total_ms,meshes,instances\n";
+    for (size_t threads : threadCounts){
+        Scene::IMPORT_THREADS = (int)threads;
+        Scene::ImportStats mean;
+        size_t meshCount = 0, instanceCount = 0;
+        for (int r = 0; r < repeats; r++){
+            Scene scene(sceneFile, false, CACHE_OFF);
+            glFinish();
+            const Scene::ImportStats& stats = scene.GetImportStats();
+            mean.readMs += stats.readMs / repeats;
+            mean.nodesMs += stats.nodesMs / repeats;
+            mean.meshesMs += stats.meshesMs / repeats;
+            mean.uploadMs += stats.uploadMs / repeats;
+            mean.materialsMs += stats.materialsMs / repeats;
+            mean.boundsMs += stats.boundsMs / repeats;
+            mean.totalMs += stats.totalMs / repeats;
+            mean.workerThreads = stats.workerThreads;
+            meshCount = scene.GetMeshCount();
+            instanceCount = scene.GetInstanceCount();
+        }
+        out << mean.workerThreads << "," << mean.readMs << "," << mean.nodesMs << "," << mean.meshesMs << ","
+            << mean.uploadMs << "," << mean.materialsMs << "," << mean.boundsMs << "," << mean.totalMs << ","
+            << meshCount << "," << instanceCount << "\n";
+        std::cout << "import, " << mean.workerThreads << " workers: total=" << mean.totalMs << " ms (read="
+                  << mean.readMs << ", nodes=" << mean.nodesMs << ", meshes=" << mean.meshesMs
+                  << " incl. upload=" << mean.uploadMs << ", materials=" << mean.materialsMs
+                  << ", bounds=" << mean.boundsMs << ") over " << repeats << " loads" << std::endl;
+    }
+    std::cout << "Wrote " << fileName << std::endl;
+    return 0;
+}
+
+int main(int argc, char** argv){
+    std::string fileName = "untitled.fbx";
+    std::string pathFile;
+    std::string outPrefix = "bench_results";
+    std::vector<Mode> modes;
+    std::vector<LightingPath> lightingPaths;
+    std::vector<ForwardLighting> forwardPaths;
+    std::vector<bool> occlusionSettings;
+    std::vector<bool> geometrySettings;
+    std::vector<bool> lodSettings;
+    std::vector<bool> depthSharingSettings;
+    std::vector<bool> adaptiveSettings;
+    GBufferLayout gbufferLayout = GBUFFER_FULL;
+    std::vector<size_t> lightCounts;
+    float lightRadius = 0.0f;
+    float overdrawScale = 0.5f;     // OverdrawMetrics::resolutionScale
+    int overdrawRefreshFrames = 0;  // Renderer::overdrawRefreshFrames
+    int width = 800, height = 800;
+    int warmupFrames = 10;
+    int holdFrames = 100;
+    int steps = 30;
+    bool dumpFrames = false;
+    SceneCacheMode cacheMode = CACHE_USE;
+    bool buildCacheOnly = false;
+    std::vector<size_t> importThreads;
+    int importRepeats = 3;
+    std::string costProfile;
+    bool calibrate = false;
+
+    for (int i = 1; i < argc; i++){
+        std::string arg(argv[i]);
+        bool hasValue = i + 1 < argc;
+        if (arg == "--path" && hasValue) pathFile = argv[++i];
+        else if (arg == "--out" && hasValue) outPrefix = argv[++i];
+        else if (arg == "--width" && hasValue) width = std::stoi(argv[++i]);
+        else if (arg == "--height" && hasValue) height = std::stoi(argv[++i]);
+        else if (arg == "--warmup" && hasValue) warmupFrames = std::stoi(argv[++i]);
+        else if (arg == "--frames" && hasValue) holdFrames = std::stoi(argv[++i]);
+        else if (arg == "--steps" && hasValue) steps = std::stoi(argv[++i]);
+        else if (arg == "--dump") dumpFrames = true;
+        else if (arg == "--build-cache") buildCacheOnly = true;
+        else if (arg == "--cost-profile" && hasValue) costProfile = argv[++i];
+        else if (arg == "--calibrate") calibrate = true;
+        else if (arg == "--import-repeats" && hasValue) importRepeats = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--import-threads" && hasValue){
+            if (!ParseCounts(argv[++i], importThreads)){
+                std::cerr << "Invalid --import-threads list (expected e.g. 1,2,4,8)\n";
+                return -1;
+            }
+        }
+        else if (arg == "--cache" && hasValue){
+            std::string value(argv[++i]);
+            if (value == "off") cacheMode = CACHE_OFF;
+            else if (value == "use") cacheMode = CACHE_USE;
+            else if (value == "rebuild") cacheMode = CACHE_REBUILD;
+            else {
+                std::cerr << "Invalid --cache value (expected off, use or rebuild)\n";
+                return -1;
+            }
+        }
+        else if (arg == "--mesh-optimization" && hasValue){
+            std::string value(argv[++i]);
+            if (value == "on") Scene::OPTIMIZE_MESHES = true;
+            else if (value == "off") Scene::OPTIMIZE_MESHES = false;
+            else {
+                std::cerr << "Invalid --mesh-optimization value (expected on or off)\n";
+                return -1;
+            }
+        }
+        else if (arg == "--lod-generation" && hasValue){
+            std::string value(argv[++i]);
+            if (value == "on") Scene::GENERATE_LODS = true;
+            else if (value == "off") Scene::GENERATE_LODS = false;
+            else {
+                std::cerr << "Invalid --lod-generation value (expected on or off)\n";
+                return -1;
+            }
+        }
+        else if (arg == "--gbuffer" && hasValue){
+            std::string value(argv[++i]);
+            if (value == "full") gbufferLayout = GBUFFER_FULL;
+            else if (value == "compact") gbufferLayout = GBUFFER_COMPACT;
+            else if (value == "material-id") gbufferLayout = GBUFFER_MATERIAL_ID;
+            else {
+                std::cerr << "Invalid --gbuffer value (expected full, compact or material-id)\n";
+                return -1;
+            }
+        }
+        else if (arg == "--vertices" && hasValue){
+            std::string value(argv[++i]);
+            if (value == "float") Scene::VERTEX_FORMAT = VERTEX_FLOAT;
+            else if (value == "compressed") Scene::VERTEX_FORMAT = VERTEX_COMPRESSED;
+            else {
+                std::cerr << "Invalid --vertices value (expected float or compressed)\n";
+                return -1;
+            }
+        }
+        else if (arg == "--light-radius" && hasValue) lightRadius = std::stof(argv[++i]);
+        else if (arg == "--overdraw-scale" && hasValue) overdrawScale = std::stof(argv[++i]);
+        else if (arg == "--overdraw-refresh" && hasValue) overdrawRefreshFrames = std::stoi(argv[++i]);
+        else if (arg == "--lighting" && hasValue){
+            if (!ParseLighting(argv[++i], lightingPaths)){
+                std::cerr << "Invalid --lighting list (expected e.g. fullscreen,tiled,volumes)\n";
+                return -1;
+            }
+        }
+        else if (arg == "--forward" && hasValue){
+            if (!ParseForward(argv[++i], forwardPaths)){
+                std::cerr << "Invalid --forward list (expected e.g. all,clustered)\n";
+                return -1;
+            }
+        }
+        else if (arg == "--occlusion" && hasValue){
+            if (!ParseOcclusion(argv[++i], occlusionSettings)){
+                std::cerr << "Invalid --occlusion list (expected e.g. off,on)\n";
+                return -1;
+            }
+        }
+        else if (arg == "--geometry" && hasValue){
+            if (!ParseGeometry(argv[++i], geometrySettings)){
+                std::cerr << "Invalid --geometry list (expected e.g. mesh,merged)\n";
+                return -1;
+            }
+        }
+        else if (arg == "--lod" && hasValue){
+            if (!ParseLod(argv[++i], lodSettings)){
+                std::cerr << "Invalid --lod list (expected e.g. on,off)\n";
+                return -1;
+            }
+        }
+        else if (arg == "--depth-sharing" && hasValue){
+            if (!ParseOcclusion(argv[++i], depthSharingSettings)){
+                std::cerr << "Invalid --depth-sharing list (expected e.g. on,off)\n";
+                return -1;
+            }
+        }
+        else if (arg == "--adaptive" && hasValue){
+            if (!ParseOcclusion(argv[++i], adaptiveSettings)){
+                std::cerr << "Invalid --adaptive list (expected e.g. off,on)\n";
+                return -1;
+            }
+        }
+        else if (arg == "--lights" && hasValue){
+            if (!ParseCounts(argv[++i], lightCounts)){
+                std::cerr << "Invalid --lights list (expected e.g. 1,64,1000)\n";
+                return -1;
+            }
+        }
+        else if (arg == "--modes" && hasValue){
+            if (!ParseModes(argv[++i], modes)){
+                std::cerr << "Invalid --modes list (expected e.g. d,f,h)\n";
+                return -1;
+            }
+        }
+        else if (arg.rfind("--", 0) != 0) fileName = arg;
+        else {
+            std::cerr << "Unknown argument " << arg << std::endl;
+            return -1;
+        }
+    }
+    if (modes.empty()) modes = {DEFERRED, FORWARD, HYBRID};
+    if (lightingPaths.empty()) lightingPaths = {LIGHTING_FULLSCREEN};
+    if (forwardPaths.empty()) forwardPaths = {FORWARD_ALL_LIGHTS};
+    if (occlusionSettings.empty()) occlusionSettings = {false};
+    if (geometrySettings.empty()) geometrySettings = {false};
+    if (lodSettings.empty()) lodSettings = {true};
+    if (depthSharingSettings.empty()) depthSharingSettings = {true};
+    if (adaptiveSettings.empty()) adaptiveSettings = {false};
+
+    EGLDisplay display;
+    EGLContext context;
+    if (!CreateHeadlessContext(display, context)) return -1;
+    HeadlessContextGuard contextGuard{display, context};
+
+    glewExperimental = GL_TRUE;
+    GLenum glewStatus = glewInit();
+    // GLEW built for GLX reports a missing X display under EGL, but core entry points are still loaded
+    if (glewStatus != GLEW_OK
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+        && glewStatus != GLEW_ERROR_NO_GLX_DISPLAY
+#endif
+    ){
+        std::cerr << "Failed to initialize GLEW\n";
+        return -1;
+    }
+    glGetError(); // Clear any error raised during GLEW's extension probing
+
+    // Offscreen target replacing the window's default framebuffer
+    GLuint targetFBO, colorRB, depthRB;
+    glGenFramebuffers(1, &targetFBO);
+    glGenRenderbuffers(1, &colorRB);
+    glGenRenderbuffers(1, &depthRB);
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorRB);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRB);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthRB);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRB);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE){
+        std::cerr << "Offscreen target incomplete!\n";
+        return -1;
+    }
+    glViewport(0, 0, width, height);
+
+    glEnable(GL_DEPTH_TEST);
+
+    if (!importThreads.empty()){
+        return RunImportBenchmark(fileName, importThreads, importRepeats, outPrefix + "_import.csv");
+    }
+    if (buildCacheOnly){
+        Scene scene(fileName, false, CACHE_REBUILD);
+        WriteMeshOptimizationCSV(outPrefix + "_meshopt.csv", scene);
+        return scene.GetMeshCount() > 0 ? 0 : -1;
+    }
+
+    if (calibrate){
+        Scene::COST_MODEL = CostModel::Calibrate(gbufferLayout);
+        Scene::COST_MODEL.Save(costProfile.empty() ? "cost_profile.txt" : costProfile);
+    } else if (!costProfile.empty()){
+        Scene::COST_MODEL = CostModel::LoadOrCalibrate(costProfile, gbufferLayout);
+    }
+    if (Scene::COST_MODEL.valid){
+        std::cout << "Cost model: " << Scene::COST_MODEL.Summary() << std::endl;
+    }
+
+    Renderer renderer(width, height, gbufferLayout);
+    renderer.countForwardFragments = true;
+    renderer.timePasses = true;
+    renderer.overdraw.resolutionScale = overdrawScale;
+    renderer.overdrawRefreshFrames = overdrawRefreshFrames;
+    auto loadStart = std::chrono::steady_clock::now();
+    Scene scene(fileName, false, cacheMode);
+    glFinish();
+    float loadMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+    std::cout << "Scene loaded in " << loadMs << " ms" << (scene.LoadedFromCache() ? " from cache" : "") << std::endl;
+    size_t geometryBytes = scene.GetGeometryBytes();
+    size_t floatGeometryBytes = scene.GetFloatLayoutGeometryBytes();
+    std::cout << "Vertex + index buffers: " << geometryBytes / (1024.0f * 1024.0f) << " MB ("
+              << floatGeometryBytes / (1024.0f * 1024.0f) << " MB as float, "
+              << (floatGeometryBytes > 0 ? 100.0f * (1.0f - (float)geometryBytes / floatGeometryBytes) : 0.0f)
+              << "% saved)" << std::endl;
+    WriteMeshOptimizationCSV(outPrefix + "_meshopt.csv", scene);
+
+    std::vector<Camera> cameras;
+    if (!pathFile.empty()){
+        cameras = ExpandCameraPath(LoadCameraPath(pathFile), steps);
+        if (cameras.empty()){
+            std::cerr << "Camera path " << pathFile << " has no keyframes\n";
+            return -1;
+        }
+        if (cameras.size() == 1) cameras.assign(holdFrames, cameras.front()); // Single keyframe: hold it
+    } else {
+        cameras.assign(holdFrames, scene.camera);
+    }
+
+    glm::vec3 boundsMin, boundsMax;
+    scene.GetBounds(boundsMin, boundsMax);
+    if (lightRadius <= 0.0f){
+        lightRadius = std::max(0.15f * glm::length(boundsMax - boundsMin), 0.1f);
+    }
+    const std::vector<Light> sceneLights = scene.GetLights();
+    if (lightCounts.empty()) lightCounts = {sceneLights.size()};
+
+    struct RunConfig {
+        LightingPath lighting;
+        ForwardLighting forward;
+        bool occlusion;
+        bool merged;
+        bool lod;
+        bool shareDepth;
+        bool adaptive;
+        Mode mode;
+    };
+    std::vector<RunConfig> configs;
+    for (LightingPath lighting : lightingPaths){
+        for (ForwardLighting forward : forwardPaths){
+            for (bool occlusion : occlusionSettings){
+                for (bool merged : geometrySettings){
+                    for (bool lod : lodSettings){
+                        for (bool shareDepth : depthSharingSettings){
+                            for (bool adaptive : adaptiveSettings){
+                                for (Mode mode : modes){
+                                    configs.push_back({lighting, forward, occlusion, merged, lod, shareDepth, adaptive, mode});
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector<ModeRun> runs;
+    for (size_t lightCount : lightCounts){
+        if (lightCount == sceneLights.size()){
+            scene.ReplaceLights(sceneLights);
+        } else {
+            scene.ReplaceLights(MakeSyntheticLights(lightCount, boundsMin, boundsMax, lightRadius));
+        }
+
+        for (const RunConfig& config : configs){
+            ModeRun run{};
+            run.mode = config.mode;
+            run.lighting = config.lighting;
+            run.forward = config.forward;
+            run.occlusion = config.occlusion;
+            run.merged = config.merged;
+            run.lod = config.lod;
+            run.shareDepth = config.shareDepth;
+            run.adaptive = config.adaptive;
+            run.lightCount = lightCount;
+            renderer.lightingPath = config.lighting;
+            renderer.forwardLighting = config.forward;
+            renderer.occlusionCulling = config.occlusion;
+            renderer.mergedGeometry = config.merged;
+            renderer.levelOfDetail = config.lod;
+            renderer.shareDepth = config.shareDepth;
+            renderer.adaptiveHybrid = config.adaptive;
+
+            // Classify from the first camera on the path, like the window does from the scene camera
+            scene.camera = cameras.front();
+            renderer.profiler.ResetHistory();
+            auto preprocessStart = std::chrono::steady_clock::now();
+            renderer.Prepare(scene, config.mode);
+            glFinish();
+            run.preprocessMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - preprocessStart).count();
+
+            for (int i = 0; i < warmupFrames; i++){
+                renderer.RefreshRenderingMode(scene, cameras[i % cameras.size()]);
+                renderer.RenderFrame(scene, cameras[i % cameras.size()], targetFBO);
+                if (config.adaptive) renderer.Adapt(scene);
+            }
+
+            std::vector<float> times;
+            times.reserve(cameras.size());
+            for (size_t i = 0; i < cameras.size(); i++){
+                glFinish();
+                auto start = std::chrono::steady_clock::now();
+                renderer.RefreshRenderingMode(scene, cameras[i]);
+                Renderer::FrameResult frame = renderer.RenderFrame(scene, cameras[i], targetFBO);
+                glFinish();
+                float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+                size_t forwardFragments = renderer.GetForwardFragments(); // Ready after glFinish
+                GpuProfiler::FrameTimes gpu;
+                renderer.profiler.Collect();
+                if (!renderer.profiler.GetLatest(gpu) || gpu.frame + 1 != renderer.GetFrameIndex()) {
+                    gpu = GpuProfiler::FrameTimes();
+                }
+                if (config.adaptive) renderer.Adapt(scene);
+
+                times.push_back(ms);
+                run.frames.push_back({i, ms, frame.deferredCount, frame.forwardCount,
+                                      frame.visibleMeshes, frame.culledMeshes, frame.occludedMeshes,
+                                      frame.materialChanges, frame.drawCalls, frame.triangles, forwardFragments, cameras[i].position,
+                                      frame.uniforms, frame.tileLightIndices, frame.clusterLightIndices, gpu});
+            }
+            run.summary = TimingSummary::Compute(times);
+            run.decisions = renderer.adaptive.GetDecisions();
+            run.overdrawGpuMs = renderer.profiler.Summary(GPU_PASS_OVERDRAW).mean; // The one sample since ResetHistory
+            run.gpuSamplesRejected = renderer.profiler.GetRejectedCount();
+
+            std::string runName = std::string(ModeName(config.mode)) + "_" + LightingName(config.lighting) + "_"
+                                + ForwardName(config.forward) + "_" + std::to_string(lightCount)
+                                + (config.occlusion ? "_occlusion" : "") + (config.merged ? "_merged" : "")
+                                + (config.lod ? "" : "_nolod") + (config.shareDepth ? "" : "_nodepthshare")
+                                + (config.adaptive ? "_adaptive" : "");
+            if (dumpFrames){
+                WritePPM(outPrefix + "_" + runName + ".ppm", targetFBO, width, height);
+            }
+
+            std::cout << runName << ": mean=" << run.summary.mean << " ms (median=" << run.summary.median
+                      << ", p95=" << run.summary.p95 << ", min=" << run.summary.min
+                      << ", max=" << run.summary.max << ") over " << run.summary.count << " frames"
+                      << ", preprocess " << run.preprocessMs << " ms"
+                      << ", " << run.gpuSamplesRejected << " GPU samples rejected" << std::endl;
+            runs.push_back(run);
+        }
+    }
+
+    WriteCSV(outPrefix + ".csv", runs);
+    if (std::find(adaptiveSettings.begin(), adaptiveSettings.end(), true) != adaptiveSettings.end()){
+        WriteAdaptiveCSV(outPrefix + "_adaptive.csv", runs);
+    }
+    WriteJSON(outPrefix + ".json", fileName, scene.GetMeshCount(), scene.GetInstanceCount(), loadMs, scene.LoadedFromCache(),
+              geometryBytes, floatGeometryBytes, width, height, renderer.gbuffer.layout, renderer.gbuffer.GetMemoryUsageMB(),
+              renderer.overdraw.resolutionScale, renderer.overdrawRefreshFrames, Scene::COST_MODEL, runs);
+    std::cout << "Wrote " << outPrefix << ".csv and " << outPrefix << ".json" << std::endl;
+    return 0;
+}
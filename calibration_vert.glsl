@@ -0,0 +1,33 @@
+#version 330 core
+
+// Full-screen layer for the cost-model microbenchmarks (CostModel.h): the quad is placed
+// at layerDepth and unprojected, so every pixel gets exactly one fragment per draw with
+// a world position consistent with the camera the lighting passes reconstruct from.
+layout(location = 0) in vec2 aPos;
+layout(location = 1) in vec2 aTex;
+
+uniform float layerDepth; // NDC depth of this layer
+uniform mat4 inverseViewProjection;
+
+#ifdef GBUFFER_OUTPUT
+out VS_OUT {
+    vec3 FragPos;
+    vec3 Normal;
+} vs_out;
+#else
+out vec3 FragPos;
+out vec3 Normal;
+#endif
+
+void main()
+{
+    vec4 world = inverseViewProjection * vec4(aPos, layerDepth, 1.0);
+#ifdef GBUFFER_OUTPUT
+    vs_out.FragPos = world.xyz / world.w;
+    vs_out.Normal = vec3(0.0, 0.0, 1.0);
+#else
+    FragPos = world.xyz / world.w;
+    Normal = vec3(0.0, 0.0, 1.0);
+#endif
+    gl_Position = vec4(aPos, layerDepth, 1.0);
+}
@@ -1,7 +1,5 @@
 #version 330 core
 
-#define MAX_LIGHTS 128
-
 in vec3 FragPos;
 in vec3 Normal;
 
@@ -18,20 +16,65 @@ struct Light {
     float constant;
     float linear;
     float quadratic;
+    float radius;
 };
 
-uniform Light lights[MAX_LIGHTS];
-
+// Lights live in a texture buffer, three RGBA32F texels per light (see LightBuffer.h)
+uniform samplerBuffer lightData;
 uniform int numLights;
 
+Light FetchLight(int i)
+{
+    vec4 positionRadius = texelFetch(lightData, i * 3);
+    vec4 colorConstant  = texelFetch(lightData, i * 3 + 1);
+    vec4 attenuation    = texelFetch(lightData, i * 3 + 2);
+
+    Light light;
+    light.position  = positionRadius.xyz;
+    light.radius    = positionRadius.w;
+    light.color     = colorConstant.rgb;
+    light.constant  = colorConstant.a;
+    light.linear    = attenuation.x;
+    light.quadratic = attenuation.y;
+    return light;
+}
+
+#ifdef CLUSTERED_LIGHTING
+// Per-cluster light lists built each frame on the CPU (see ClusteredLighting.h)
+uniform usamplerBuffer clusterGrid;          // (offset, count) into clusterLightIndices, one texel per cluster
+uniform usamplerBuffer clusterLightIndices;  // Light indices of all clusters, concatenated
+uniform int clusterTileSize;
+uniform int clustersX;
+uniform int clustersY;
+uniform int clusterSlices;
+uniform float clusterNear;
+uniform float clusterSliceScale;             // clusterSlices / log(far / near)
+uniform mat4 view;
+#endif
+
+#ifdef MERGED_GEOMETRY
+struct Material {
+    vec3 diffuse;
+    vec3 specular;
+    float shininess;
+    float opacity;
+};
+flat in vec4 DrawDiffuseShininess;
+flat in vec4 DrawSpecularOpacity;
+#else
 uniform struct {
     vec3 diffuse;
     vec3 specular;
     float shininess;
     float opacity;
 } material;
+#endif
 
 void main(){ 
+#ifdef MERGED_GEOMETRY
+    Material material = Material(DrawDiffuseShininess.rgb, DrawSpecularOpacity.rgb,
+                                 DrawDiffuseShininess.a, DrawSpecularOpacity.a);
+#endif
     // Ensure minimum diffuse color to prevent pure black materials
     vec3 diffuse = max(material.diffuse, vec3(0.01));
     
@@ -42,24 +85,42 @@ void main(){
     // Normalize normal once (matches deferred shader)
     vec3 N = normalize(Normal);
 
-    for (int i = 0; i < min(numLights, MAX_LIGHTS); i++){    
+#ifdef CLUSTERED_LIGHTING
+    // Only the lights whose volume overlaps this fragment's froxel
+    ivec2 tile = ivec2(gl_FragCoord.xy) / clusterTileSize;
+    float viewDepth = -(view * vec4(FragPos, 1.0)).z;
+    int slice = clamp(int(floor(log(max(viewDepth, clusterNear) / clusterNear) * clusterSliceScale)), 0, clusterSlices - 1);
+    int cluster = (slice * clustersY + tile.y) * clustersX + tile.x;
+    uvec2 clusterRange = texelFetch(clusterGrid, cluster).xy;
+    for (uint c = 0u; c < clusterRange.y; c++){
+        int i = int(texelFetch(clusterLightIndices, int(clusterRange.x + c)).r);
+        Light light = FetchLight(i);
+
+        // Cluster lists are conservative: still skip lights out of range of this fragment
+        if (length(light.position - FragPos) > light.radius)
+            continue;
+#else
+    for (int i = 0; i < numLights; i++){    
+        Light light = FetchLight(i);
+#endif
+
         // Calculate distance and attenuation
-        vec3 lightDir = lights[i].position - FragPos;
+        vec3 lightDir = light.position - FragPos;
         float distance = length(lightDir);
         
         // Prevent division by zero and ensure minimum distance
         distance = max(distance, 0.001);
         
-        float attenuation = 1.0 / (lights[i].constant + lights[i].linear * distance + lights[i].quadratic * (distance * distance));
+        float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
         
         // diffuse
         vec3 Lm = normalize(lightDir);
-        vec3 Id = lights[i].color * max(dot(N, Lm), 0.0);
+        vec3 Id = light.color * max(dot(N, Lm), 0.0);
 
         // specular
         vec3 V = normalize(viewPos - FragPos);
         vec3 Rm = reflect(-Lm, N);
-        vec3 Is = lights[i].color * pow(max(dot(Rm, V), 0.0), material.shininess);
+        vec3 Is = light.color * pow(max(dot(Rm, V), 0.0), material.shininess);
 
         // Apply attenuation to light contribution
         finalColor += (Id * diffuse + Is * material.specular) * attenuation;
@@ -8,10 +8,41 @@ out vec3 Normal;
 
 uniform mat4 projection;
 uniform mat4 view;
-uniform mat4 model;
+
+#ifdef MERGED_GEOMETRY
+// Per-instance model matrix and material, seven RGBA32F texels per instance (see GeometryArena.h)
+layout (location = 2) in uint instanceIndex;
+uniform samplerBuffer drawData;
+flat out vec4 DrawDiffuseShininess;
+flat out vec4 DrawSpecularOpacity;
+#else
+// Per-instance model matrices, four RGBA32F texels each (see InstanceBuffer.h)
+uniform samplerBuffer instanceData;
+uniform int instanceBase;
+// Mesh dequantization: offset 0 / scale 1 for float vertices, bounds min / extent
+// for 16-bit normalized positions (see CompressedVertex in Mesh.h)
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+#endif
 
 void main(){ 
-    gl_Position = projection * view * model * vec4(pos, 1.0); 
+#ifdef MERGED_GEOMETRY
+    int base = int(instanceIndex) * 7;
+    mat4 model = mat4(texelFetch(drawData, base), texelFetch(drawData, base + 1),
+                      texelFetch(drawData, base + 2), texelFetch(drawData, base + 3));
+    DrawDiffuseShininess = texelFetch(drawData, base + 4);
+    DrawSpecularOpacity  = texelFetch(drawData, base + 5);
+#else
+    int base = (instanceBase + gl_InstanceID) * 4;
+    mat4 model = mat4(texelFetch(instanceData, base), texelFetch(instanceData, base + 1),
+                      texelFetch(instanceData, base + 2), texelFetch(instanceData, base + 3));
+#endif
+#ifdef MERGED_GEOMETRY
+    vec3 position = pos;
+#else
+    vec3 position = positionOffset + pos * positionScale;
+#endif
+    gl_Position = projection * view * model * vec4(position, 1.0); 
     Normal = mat3(transpose(inverse(model))) * norm;
-    FragPos = vec3(model * vec4(pos, 1.0));
+    FragPos = vec3(model * vec4(position, 1.0));
 }
\ No newline at end of file
@@ -1,26 +1,77 @@
 #version 330 core
 
+#ifdef COMPACT_GBUFFER
+// Position is reconstructed from depth (see GBuffer.h)
+layout(location = 1) out vec2 gNormal;     // octahedral, remapped to [0, 1]
+#ifdef MATERIAL_ID_GBUFFER
+layout(location = 2) out uint gMaterial;   // index into the material table (MaterialBuffer.h)
+#else
+layout(location = 2) out vec4 gAlbedoSpec; // rgb = diffuse, a = log2(shininess + 1) / 12
+layout(location = 3) out vec4 gSpecular;   // specular color (rgb)
+#endif
+#else
 layout(location = 0) out vec3 gPosition;
 layout(location = 1) out vec3 gNormal;
 layout(location = 2) out vec4 gAlbedoSpec; // rgb = diffuse, a = shininess
 layout(location = 3) out vec3 gSpecular; // specular color
+#endif
 
 in VS_OUT {
     vec3 FragPos;
     vec3 Normal;
 } fs_in;
 
+#if defined(MATERIAL_ID_GBUFFER) && defined(MERGED_GEOMETRY)
+flat in uint DrawMaterial;
+#elif defined(MATERIAL_ID_GBUFFER)
+uniform int materialIndex;
+#elif defined(MERGED_GEOMETRY)
+struct Material {
+    vec3 diffuse;
+    vec3 specular;
+    float shininess;
+};
+flat in vec4 DrawDiffuseShininess;
+flat in vec4 DrawSpecularOpacity;
+#else
 uniform struct {
     vec3 diffuse;
     vec3 specular;
     float shininess;
 } material;
+#endif
+
+#ifdef COMPACT_GBUFFER
+// Unit vector onto the octahedron, lower half folded over the diagonals
+vec2 OctahedralEncode(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return e * 0.5 + 0.5;
+}
+#endif
 
 void main()
 {
+#if defined(MERGED_GEOMETRY) && !defined(MATERIAL_ID_GBUFFER)
+    Material material = Material(DrawDiffuseShininess.rgb, DrawSpecularOpacity.rgb, DrawDiffuseShininess.a);
+#endif
+#ifdef COMPACT_GBUFFER
+    gNormal   = OctahedralEncode(normalize(fs_in.Normal));
+#if defined(MATERIAL_ID_GBUFFER) && defined(MERGED_GEOMETRY)
+    gMaterial = DrawMaterial;
+#elif defined(MATERIAL_ID_GBUFFER)
+    gMaterial = uint(materialIndex);
+#else
+    gAlbedoSpec.rgb = material.diffuse;
+    gAlbedoSpec.a   = log2(max(material.shininess, 0.0) + 1.0) / 12.0;
+    gSpecular = vec4(material.specular, 1.0);
+#endif
+#else
     gPosition = fs_in.FragPos;
     gNormal   = normalize(fs_in.Normal);
     gAlbedoSpec.rgb = material.diffuse;
     gAlbedoSpec.a   = material.shininess;
     gSpecular = material.specular;
+#endif
 }
@@ -3,7 +3,6 @@
 layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec3 aNormal;
 
-uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
@@ -12,10 +11,44 @@ out VS_OUT {
     vec3 Normal;
 } vs_out;
 
+#ifdef MERGED_GEOMETRY
+// Per-instance model matrix and material, seven RGBA32F texels per instance (see GeometryArena.h)
+layout(location = 2) in uint aInstanceIndex;
+uniform samplerBuffer drawData;
+flat out vec4 DrawDiffuseShininess;
+flat out vec4 DrawSpecularOpacity;
+flat out uint DrawMaterial; // Read by the material-ID G-buffer
+#else
+// Per-instance model matrices, four RGBA32F texels each (see InstanceBuffer.h)
+uniform samplerBuffer instanceData;
+uniform int instanceBase;
+// Mesh dequantization: offset 0 / scale 1 for float vertices, bounds min / extent
+// for 16-bit normalized positions (see CompressedVertex in Mesh.h)
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+#endif
 
 void main()
 {
-    vec4 worldPos = model * vec4(aPos, 1.0);
+#ifdef MERGED_GEOMETRY
+    int base = int(aInstanceIndex) * 7;
+    mat4 model = mat4(texelFetch(drawData, base), texelFetch(drawData, base + 1),
+                      texelFetch(drawData, base + 2), texelFetch(drawData, base + 3));
+    DrawDiffuseShininess = texelFetch(drawData, base + 4);
+    DrawSpecularOpacity  = texelFetch(drawData, base + 5);
+    DrawMaterial = uint(texelFetch(drawData, base + 6).x);
+#else
+    int base = (instanceBase + gl_InstanceID) * 4;
+    mat4 model = mat4(texelFetch(instanceData, base), texelFetch(instanceData, base + 1),
+                      texelFetch(instanceData, base + 2), texelFetch(instanceData, base + 3));
+#endif
+#ifdef MERGED_GEOMETRY
+    vec3 position = aPos;
+#else
+    vec3 position = positionOffset + aPos * positionScale;
+#endif
+
+    vec4 worldPos = model * vec4(position, 1.0);
     vs_out.FragPos = worldPos.xyz;
 
     // Store world-space normal (just like forward pass)
@@ -0,0 +1,28 @@
+#version 330 core
+
+in vec2 TexCoords;
+out vec4 FragColor;
+
+#ifdef MATERIAL_ID_GBUFFER
+uniform usampler2D gMaterial;
+// Material table, two RGBA32F texels per material (see MaterialBuffer.h)
+uniform samplerBuffer materialData;
+#else
+uniform sampler2D gAlbedoSpec;
+#endif
+uniform float ambientStrength;
+uniform vec3 ambientColor;
+
+// Ambient term of the light-volume path. Background pixels are rejected by the
+// stencil test, so no G-buffer validity check is needed here.
+void main()
+{
+    // Ensure minimum diffuse color to prevent pure black materials (matches lighting_frag.glsl)
+#ifdef MATERIAL_ID_GBUFFER
+    int material = int(texelFetch(gMaterial, ivec2(gl_FragCoord.xy), 0).r) * 2;
+    vec3 Diffuse = max(texelFetch(materialData, material).rgb, vec3(0.01));
+#else
+    vec3 Diffuse = max(texture(gAlbedoSpec, TexCoords).rgb, vec3(0.01));
+#endif
+    FragColor = vec4(ambientColor * ambientStrength * Diffuse, 1.0);
+}
@@ -0,0 +1,132 @@
+#version 330 core
+
+flat in int LightIndex;
+out vec4 FragColor;
+
+#ifdef COMPACT_GBUFFER
+uniform sampler2D gDepth;
+uniform mat4 inverseViewProjection;
+#else
+uniform sampler2D gPosition;
+#endif
+uniform sampler2D gNormal;
+#ifdef MATERIAL_ID_GBUFFER
+uniform usampler2D gMaterial;
+// Material table, two RGBA32F texels per material (see MaterialBuffer.h)
+uniform samplerBuffer materialData;
+#else
+uniform sampler2D gAlbedoSpec;
+uniform sampler2D gSpecular;
+#endif
+
+uniform vec3 viewPos;
+
+struct Light {
+    vec3 position;
+    vec3 color;
+    float constant;
+    float linear;
+    float quadratic;
+    float radius;
+};
+
+// Lights live in a texture buffer, three RGBA32F texels per light (see LightBuffer.h)
+uniform samplerBuffer lightData;
+
+Light FetchLight(int i)
+{
+    vec4 positionRadius = texelFetch(lightData, i * 3);
+    vec4 colorConstant  = texelFetch(lightData, i * 3 + 1);
+    vec4 attenuation    = texelFetch(lightData, i * 3 + 2);
+
+    Light light;
+    light.position  = positionRadius.xyz;
+    light.radius    = positionRadius.w;
+    light.color     = colorConstant.rgb;
+    light.constant  = colorConstant.a;
+    light.linear    = attenuation.x;
+    light.quadratic = attenuation.y;
+    return light;
+}
+
+#ifdef COMPACT_GBUFFER
+// Decoding of the compact G-buffer (see gbuffer_frag.glsl)
+vec3 ReconstructPosition(vec2 uv, float depth)
+{
+    vec4 position = inverseViewProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    return position.xyz / position.w;
+}
+
+vec3 OctahedralDecode(vec2 e)
+{
+    e = e * 2.0 - 1.0;
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+float DecodeShininess(float encoded)
+{
+    return exp2(encoded * 12.0) - 1.0;
+}
+#endif
+
+// Unmapped radiance of a single light, additively blended into the HDR target.
+// Background pixels and pixels behind the volume were already rejected by the
+// stencil and depth tests; this only rejects pixels in front of the volume.
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    Light light = FetchLight(LightIndex);
+
+#ifdef COMPACT_GBUFFER
+    vec2 uv = (vec2(pixel) + 0.5) / vec2(textureSize(gDepth, 0));
+    vec3 FragPos = ReconstructPosition(uv, texelFetch(gDepth, pixel, 0).r);
+#else
+    vec3 FragPos = texelFetch(gPosition, pixel, 0).rgb;
+#endif
+    vec3 lightDir = light.position - FragPos;
+    float distance = length(lightDir);
+    if (distance > light.radius) {
+        discard;
+    }
+
+#if defined(MATERIAL_ID_GBUFFER)
+    int material = int(texelFetch(gMaterial, pixel, 0).r) * 2;
+    vec4 DiffuseShininess = texelFetch(materialData, material);
+    vec3 Diffuse = max(DiffuseShininess.rgb, vec3(0.01));
+    vec3 Normal  = OctahedralDecode(texelFetch(gNormal, pixel, 0).rg);
+    float Shininess = DiffuseShininess.a;
+    vec3 Specular = texelFetch(materialData, material + 1).rgb;
+#elif defined(COMPACT_GBUFFER)
+    vec4 AlbedoSpec = texelFetch(gAlbedoSpec, pixel, 0);
+    vec3 Diffuse = max(AlbedoSpec.rgb, vec3(0.01));
+    vec3 Normal  = OctahedralDecode(texelFetch(gNormal, pixel, 0).rg);
+    float Shininess = DecodeShininess(AlbedoSpec.a);
+    vec3 Specular = texelFetch(gSpecular, pixel, 0).rgb;
+#else
+    vec4 AlbedoSpec = texelFetch(gAlbedoSpec, pixel, 0);
+    vec3 Diffuse = max(AlbedoSpec.rgb, vec3(0.01));
+    vec3 Normal  = normalize(texelFetch(gNormal, pixel, 0).rgb);
+    float Shininess = AlbedoSpec.a;
+    vec3 Specular = texelFetch(gSpecular, pixel, 0).rgb;
+#endif
+
+    // Prevent division by zero and ensure minimum distance
+    distance = max(distance, 0.001);
+
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+
+    vec3 L = normalize(lightDir);
+    vec3 V = normalize(viewPos - FragPos);
+    vec3 R = reflect(-L, Normal);
+
+    float diff = max(dot(Normal, L), 0.0);
+    float spec = pow(max(dot(R, V), 0.0), Shininess);
+
+    vec3 Id = light.color * diff;
+    vec3 Is = light.color * spec;
+
+    FragColor = vec4((Id * Diffuse + Is * Specular) * attenuation, 1.0);
+}
@@ -0,0 +1,19 @@
+#version 330 core
+
+layout(location = 0) in vec3 aPos; // Unit bounding sphere
+
+uniform mat4 view;
+uniform mat4 projection;
+
+// Lights live in a texture buffer, three RGBA32F texels per light (see LightBuffer.h)
+uniform samplerBuffer lightData;
+
+flat out int LightIndex;
+
+void main()
+{
+    // One instance per light: place the sphere at the light and scale it to its radius
+    vec4 positionRadius = texelFetch(lightData, gl_InstanceID * 3);
+    LightIndex = gl_InstanceID;
+    gl_Position = projection * view * vec4(positionRadius.xyz + aPos * positionRadius.w, 1.0);
+}
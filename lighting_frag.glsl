@@ -3,10 +3,21 @@
 in vec2 TexCoords;
 out vec4 FragColor;
 
+#ifdef COMPACT_GBUFFER
+uniform sampler2D gDepth;
+uniform mat4 inverseViewProjection;
+#else
 uniform sampler2D gPosition;
+#endif
 uniform sampler2D gNormal;
+#ifdef MATERIAL_ID_GBUFFER
+uniform usampler2D gMaterial;
+// Material table, two RGBA32F texels per material (see MaterialBuffer.h)
+uniform samplerBuffer materialData;
+#else
 uniform sampler2D gAlbedoSpec;
 uniform sampler2D gSpecular;
+#endif
 
 uniform vec3 viewPos;
 uniform float ambientStrength;
@@ -21,11 +32,81 @@ struct Light {
     float quadratic;
     float radius;
 };
-uniform Light lights[128];
+
+// Lights live in a texture buffer, three RGBA32F texels per light (see LightBuffer.h)
+uniform samplerBuffer lightData;
 uniform int numLights;
 
+Light FetchLight(int i)
+{
+    vec4 positionRadius = texelFetch(lightData, i * 3);
+    vec4 colorConstant  = texelFetch(lightData, i * 3 + 1);
+    vec4 attenuation    = texelFetch(lightData, i * 3 + 2);
+
+    Light light;
+    light.position  = positionRadius.xyz;
+    light.radius    = positionRadius.w;
+    light.color     = colorConstant.rgb;
+    light.constant  = colorConstant.a;
+    light.linear    = attenuation.x;
+    light.quadratic = attenuation.y;
+    return light;
+}
+
+#ifdef TILED_LIGHTING
+// Per-tile light lists built each frame on the CPU (see TiledLighting.h)
+uniform usamplerBuffer tileGrid;          // (offset, count) into tileLightIndices, one texel per tile
+uniform usamplerBuffer tileLightIndices;  // Light indices of all tiles, concatenated
+uniform int tileSize;
+uniform int tilesX;
+#endif
+
+#ifdef COMPACT_GBUFFER
+// Decoding of the compact G-buffer (see gbuffer_frag.glsl)
+vec3 ReconstructPosition(vec2 uv, float depth)
+{
+    vec4 position = inverseViewProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    return position.xyz / position.w;
+}
+
+vec3 OctahedralDecode(vec2 e)
+{
+    e = e * 2.0 - 1.0;
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+float DecodeShininess(float encoded)
+{
+    return exp2(encoded * 12.0) - 1.0;
+}
+#endif
+
 void main()
 {
+#ifdef COMPACT_GBUFFER
+    float depth = texture(gDepth, TexCoords).r;
+    if (depth >= 1.0) {
+        FragColor = vec4(0.0, 0.0, 0.0, 1.0); // Background: nothing was drawn here
+        return;
+    }
+    vec3 FragPos = ReconstructPosition(TexCoords, depth);
+    vec3 Normal  = OctahedralDecode(texture(gNormal, TexCoords).rg);
+#ifdef MATERIAL_ID_GBUFFER
+    int material = int(texelFetch(gMaterial, ivec2(gl_FragCoord.xy), 0).r) * 2;
+    vec4 DiffuseShininess = texelFetch(materialData, material);
+    vec3 Diffuse = DiffuseShininess.rgb;
+    float Shininess = DiffuseShininess.a;
+    vec3 Specular = texelFetch(materialData, material + 1).rgb;
+#else
+    vec4 AlbedoSpec = texture(gAlbedoSpec, TexCoords);
+    vec3 Diffuse = AlbedoSpec.rgb;
+    float Shininess = DecodeShininess(AlbedoSpec.a);
+    vec3 Specular = texture(gSpecular, TexCoords).rgb;
+#endif
+#else
     vec3 FragPos = texture(gPosition, TexCoords).rgb;
     vec3 Normal  = normalize(texture(gNormal, TexCoords).rgb);
     vec3 Diffuse = texture(gAlbedoSpec, TexCoords).rgb;
@@ -38,6 +119,7 @@ void main()
         FragColor = vec4(0.0, 0.0, 0.0, 1.0);
         return;
     }
+#endif
 
     // Ensure minimum diffuse color to prevent pure black materials
     Diffuse = max(Diffuse, vec3(0.01));
@@ -46,14 +128,25 @@ void main()
     vec3 Ia = ambientColor * ambientStrength;
     vec3 result = Ia * Diffuse;
 
-    for (int i = 0; i < min(numLights, 128); ++i)
+#ifdef TILED_LIGHTING
+    // Only the lights whose volume overlaps this pixel's tile (screen rect and depth range)
+    ivec2 tile = ivec2(gl_FragCoord.xy) / tileSize;
+    uvec2 tileRange = texelFetch(tileGrid, tile.y * tilesX + tile.x).xy;
+    for (uint t = 0u; t < tileRange.y; ++t)
     {
+        int i = int(texelFetch(tileLightIndices, int(tileRange.x + t)).r);
+#else
+    for (int i = 0; i < numLights; ++i)
+    {
+#endif
+        Light light = FetchLight(i);
+
         // Calculate distance between light source and current fragment
-        vec3 lightDir = lights[i].position - FragPos;
+        vec3 lightDir = light.position - FragPos;
         float distance = length(lightDir);
         
         // Light volume culling: skip lights outside their effective radius
-        if (distance > lights[i].radius) {
+        if (distance > light.radius) {
             continue; // Skip this light, it's too far away to contribute
         }
         
@@ -61,7 +154,7 @@ void main()
         distance = max(distance, 0.001);
         
         // Calculate attenuation
-        float attenuation = 1.0 / (lights[i].constant + lights[i].linear * distance + lights[i].quadratic * (distance * distance));
+        float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
         
         vec3 L = normalize(lightDir);
         vec3 V = normalize(viewPos - FragPos);
@@ -71,9 +164,9 @@ void main()
         float spec = pow(max(dot(R, V), 0.0), Shininess);
 
         // Match forward shader exactly: Id * material.diffuse + Is * material.specular
-        // where Id = lights[i].color * diff, Is = lights[i].color * spec
-        vec3 Id = lights[i].color * diff;
-        vec3 Is = lights[i].color * spec;
+        // where Id = light.color * diff, Is = light.color * spec
+        vec3 Id = light.color * diff;
+        vec3 Is = light.color * spec;
         
         // Apply attenuation to light contribution
         result += (Id * Diffuse + Is * Specular) * attenuation;
@@ -0,0 +1,13 @@
+#version 330 core
+
+layout(location = 0) in vec3 aPos; // Unit cube corner in [0, 1]
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 boxMin;
+uniform vec3 boxSize;
+
+void main()
+{
+    gl_Position = projection * view * vec4(boxMin + aPos * boxSize, 1.0);
+}
@@ -0,0 +1,59 @@
+#version 330 core
+
+// Tiled lighting: one fragment per screen tile, writes the min/max view-space
+// depth of the G-buffer pixels in that tile. Background pixels are ignored, so
+// empty tiles come out as (+inf, -inf) and receive no lights.
+
+out vec2 DepthBounds;
+
+#ifdef COMPACT_GBUFFER
+uniform sampler2D gDepth; // Hardware depth; 1.0 where nothing was drawn
+uniform mat4 inverseProjection;
+#else
+uniform sampler2D gPosition;
+uniform mat4 view;
+#endif
+uniform int tileSize;
+
+void main()
+{
+#ifdef COMPACT_GBUFFER
+    ivec2 size = textureSize(gDepth, 0);
+#else
+    ivec2 size = textureSize(gPosition, 0);
+#endif
+    ivec2 origin = ivec2(gl_FragCoord.xy) * tileSize;
+
+    float minDepth = 1e30;
+    float maxDepth = -1e30;
+
+    for (int y = 0; y < tileSize; ++y)
+    {
+        for (int x = 0; x < tileSize; ++x)
+        {
+            ivec2 pixel = origin + ivec2(x, y);
+            if (pixel.x >= size.x || pixel.y >= size.y)
+                continue;
+
+#ifdef COMPACT_GBUFFER
+            float windowDepth = texelFetch(gDepth, pixel, 0).r;
+            if (windowDepth >= 1.0)
+                continue; // Background (same test as the lighting pass)
+
+            vec2 ndc = (vec2(pixel) + 0.5) / vec2(size) * 2.0 - 1.0;
+            vec4 viewPosition = inverseProjection * vec4(ndc, windowDepth * 2.0 - 1.0, 1.0);
+            float depth = -viewPosition.z / viewPosition.w;
+#else
+            vec3 position = texelFetch(gPosition, pixel, 0).rgb;
+            if (length(position) < 0.001)
+                continue; // Background (same test as the lighting pass)
+
+            float depth = -(view * vec4(position, 1.0)).z;
+#endif
+            minDepth = min(minDepth, depth);
+            maxDepth = max(maxDepth, depth);
+        }
+    }
+
+    DepthBounds = vec2(minDepth, maxDepth);
+}
@@ -0,0 +1,17 @@
+#version 330 core
+
+in vec2 TexCoords;
+out vec4 FragColor;
+
+uniform sampler2D hdrBuffer;
+uniform float exposure;
+
+// Resolve of the light-volume path: same tone mapping as lighting_frag.glsl,
+// applied once to the accumulated radiance of all lights
+void main()
+{
+    vec3 result = max(texture(hdrBuffer, TexCoords).rgb, vec3(0.0));
+    result = vec3(1.0) - exp(-result * exposure);
+    result = clamp(result, vec3(0.0), vec3(1.0));
+    FragColor = vec4(result, 1.0);
+}